@@ -1,34 +1,35 @@
 #pragma once
 
 #include "chess_types.h"
+#include <array>
 #include <ostream>
 #include <string>
 #include "lookup_tables.h"
+#include "pst.h"
 #include <utility>
 
 // stockfish PRNG
 class PRNG {
 	uint64_t s;
 
-	uint64_t rand64() {
+	constexpr uint64_t rand64() {
 		s ^= s >> 12, s ^= s << 25, s ^= s >> 27;
 		return s * 2685821657736338717LL;
 	}
 public:
-	PRNG(uint64_t seed) : s(seed) {}
-	template<typename T> T rand() { return T(rand64()); }
+	constexpr PRNG(uint64_t seed) : s(seed) {}
+	template<typename T> constexpr T rand() { return T(rand64()); }
 
 	template<typename T>
-	T sparse_rand() {
+	constexpr T sparse_rand() {
 		return T(rand64() & rand64() & rand64());
 	}
 };
-// zobrist keys
+// zobrist keys, generated at compile time
 namespace zobrist {
-	extern uint64_t zobrist_table[NPIECES][NSQUARES];
-	extern uint64_t zobrist_side;
-	extern uint64_t zobrist_ep[8];  
-	extern void initialise_zobrist_keys();
+	extern const std::array<std::array<uint64_t, NSQUARES>, NPIECES> zobrist_table;
+	extern const uint64_t zobrist_side;
+	extern const std::array<uint64_t, 8> zobrist_ep;
 }
 
 struct UndoInfo {
@@ -36,28 +37,65 @@ struct UndoInfo {
 	Piece captured;
 	Square epsq;
 	int halfmove_clock;
+	// running material + PST sums (white minus black) and game phase;
+	// kept per ply so undo restores them by popping the ply
+	int psq_mg;
+	int psq_eg;
+	int phase;
+	// the move into this ply and the piece that made it (null for the root
+	// and null moves), so the nnue accumulators can replay it lazily
+	Move move;
+	Piece moved;
+	// per-colour bits set once this ply's nnue accumulator is up to date
+	uint8_t nnue_computed;
+	// for the side to move: the pieces giving check, its pieces pinned to
+	// its king, its pieces whose move would uncover check on the enemy king,
+	// and per piece type the squares that piece would check from. Filled in
+	// by set_check_info once per ply.
+	Bitboard checkers;
+	Bitboard pinned;
+	Bitboard discoverers;
+	Bitboard check_squares[NPIECE_TYPES];
 
-	constexpr UndoInfo() : entry(0), captured(NO_PIECE), epsq(NO_SQ), halfmove_clock(0) {}
+	UndoInfo() : entry(0), captured(NO_PIECE), epsq(NO_SQ), halfmove_clock(0),
+		psq_mg(0), psq_eg(0), phase(0), moved(NO_PIECE), nnue_computed(0),
+		checkers(0), pinned(0), discoverers(0), check_squares{} {}
 
     UndoInfo(const UndoInfo& prev) :
         entry(prev.entry), captured(NO_PIECE), epsq(NO_SQ),
-        halfmove_clock(prev.halfmove_clock + 1) {}
+        halfmove_clock(prev.halfmove_clock + 1),
+        psq_mg(prev.psq_mg), psq_eg(prev.psq_eg), phase(prev.phase),
+        moved(NO_PIECE), nnue_computed(0),
+        checkers(0), pinned(0), discoverers(0), check_squares{} {}
+};
+
+// what generate_legals produces. Captures are every capture plus the quiet
+// queen promotions and quiets are everything else, so between them they are
+// exactly the legal moves. Evasions are the legal moves of a side in check,
+// and nothing when not in check.
+enum GenType {
+	GEN_ALL,
+	GEN_CAPTURES,
+	GEN_QUIETS,
+	GEN_EVASIONS
 };
 
+// plies of undo history a position holds; see PositionManager::drop_history
+#define HISTORY_PLIES 256
+
 class PositionManager {
 private:
 	Bitboard piece_bb[NPIECES];
 	Piece board[NSQUARES];
 	uint64_t hash;
+	uint64_t pawn_hash;
 public:
-	UndoInfo history[256];
-	Bitboard checkers;
-	Bitboard pinned;
+	UndoInfo history[HISTORY_PLIES];
 	Color side_to_play;
 	int game_ply;
 
 	PositionManager() : piece_bb{ 0 }, side_to_play(WHITE), game_ply(0), board{},
-		hash(0), pinned(0), checkers(0) {
+		hash(0), pawn_hash(0) {
 
 		for (int i = 0; i < 64; i++) board[i] = NO_PIECE;
 		history[0] = UndoInfo();
@@ -67,9 +105,17 @@ public:
 		board[s] = pc;
 		piece_bb[pc] |= SQUARE_BB[s];
 		hash ^= zobrist::zobrist_table[pc][s];
+		if (piece_type(pc) == PAWN) pawn_hash ^= zobrist::zobrist_table[pc][s];
+		history[game_ply].psq_mg += PSQ.mg[pc][s];
+		history[game_ply].psq_eg += PSQ.eg[pc][s];
+		history[game_ply].phase += PSQ.phase[pc];
 	}
 	inline void remove_piece(Square s) {
 		hash ^= zobrist::zobrist_table[board[s]][s];
+		if (piece_type(board[s]) == PAWN) pawn_hash ^= zobrist::zobrist_table[board[s]][s];
+		history[game_ply].psq_mg -= PSQ.mg[board[s]][s];
+		history[game_ply].psq_eg -= PSQ.eg[board[s]][s];
+		history[game_ply].phase -= PSQ.phase[board[s]];
 		piece_bb[board[s]] &= ~SQUARE_BB[s];
 		board[s] = NO_PIECE;
 	}
@@ -83,7 +129,14 @@ public:
 	}
 
 	friend std::ostream& operator<<(std::ostream& os, const PositionManager& p);
+	// whether set() can take fen: well-formed fields, a king each, no pawn
+	// on a back rank and an ep square behind a pawn that could have just
+	// double-pushed. set() itself trusts its input.
+	static bool is_valid_fen(const std::string& fen);
 	static void set(const std::string& fen, PositionManager& p);
+	// shifts the last keep plies to the bottom of the history, freeing the
+	// top for more moves; the dropped plies can no longer be undone
+	void drop_history(int keep);
 	std::string fen() const;
 
 	inline bool operator==(const PositionManager& other) const { return hash == other.hash; }
@@ -94,6 +147,10 @@ public:
 	inline Color turn() const { return side_to_play; }
 	inline int ply() const { return game_ply; }
 	inline uint64_t get_hash() const { return hash; }
+	// zobrist key of the pawns alone, for the pawn structure cache
+	inline uint64_t get_pawn_hash() const { return pawn_hash; }
+	// hash the position will have once m is played and the side flipped
+	inline uint64_t key_after(Move m) const;
 
 	template<Color C> inline Bitboard diagonal_sliders() const;
 	template<Color C> inline Bitboard orthogonal_sliders() const;
@@ -104,13 +161,43 @@ public:
 		return attackers_from<~C>(bsf(bitboard_of(C, KING)), all_pieces<WHITE>() | all_pieces<BLACK>());
 	}
 
+	inline Bitboard checkers() const { return history[game_ply].checkers; }
+	inline Bitboard pinned() const { return history[game_ply].pinned; }
+
+	// fills in this ply's check and pin info; play does it for every move
+	template<Color Us> void set_check_info();
+	inline void set_check_info() {
+		if (side_to_play == WHITE) set_check_info<WHITE>(); else set_check_info<BLACK>();
+	}
+
+	// whether m, legal here, checks the enemy king
+	template<Color Us> bool gives_check(Move m) const;
+	inline bool gives_check(Move m) const {
+		return side_to_play == WHITE ? gives_check<WHITE>(m) : gives_check<BLACK>(m);
+	}
+
 	template<Color C> void play(Move m);
 	template<Color C> void undo(Move m);
 
-	template<Color Us>
+	template<Color Us, GenType Type = GEN_ALL>
 	Move *generate_legals(Move* list);
 
+	// whether a move from elsewhere (the TT, a killer slot) fits this board,
+	// checked without generating. Pseudo-legal moves may still leave the
+	// king in check; legal ones are exactly what generate_legals gives.
+	template<Color Us> bool is_pseudo_legal(Move m) const;
+	template<Color Us> bool is_legal(Move m) const;
+	inline bool is_pseudo_legal(Move m) const {
+		return side_to_play == WHITE ? is_pseudo_legal<WHITE>(m) : is_pseudo_legal<BLACK>(m);
+	}
+	inline bool is_legal(Move m) const {
+		return side_to_play == WHITE ? is_legal<WHITE>(m) : is_legal<BLACK>(m);
+	}
+
 	inline int halfmove_clock() const { return history[game_ply].halfmove_clock; }
+	inline int psq_mg() const { return history[game_ply].psq_mg; }
+	inline int psq_eg() const { return history[game_ply].psq_eg; }
+	inline int phase() const { return history[game_ply].phase; }
 	inline void reset_halfmove_clock() { history[game_ply].halfmove_clock = 0; }
 };
 template<Color C>
@@ -144,11 +231,43 @@ inline Bitboard PositionManager::attackers_from(Square s, Bitboard occ) const {
 		(attacks<ROOK>(s, occ) & (piece_bb[BLACK_ROOK] | piece_bb[BLACK_QUEEN]));
 }
 
+inline uint64_t PositionManager::key_after(const Move m) const {
+	const Square from = m.from(), to = m.to();
+	const Piece pc = board[from];
+	const MoveFlags mf = m.flags();
+	uint64_t k = hash ^ zobrist::zobrist_side ^ zobrist::zobrist_table[pc][from];
+
+	if (mf == EN_PASSANT) {
+		Square cap = Square(to ^ 8);
+		k ^= zobrist::zobrist_table[board[cap]][cap];
+	} else if (mf & CAPTURE) {
+		k ^= zobrist::zobrist_table[board[to]][to];
+	}
+
+	if (mf == OO || mf == OOO) {
+		const Color c = piece_color(pc);
+		const Piece rook = make_piece(c, ROOK);
+		const Square king_to = Square(mf == OO ? from + 2 : from - 2);
+		const Square rook_from = Square(mf == OO ? from + 3 : from - 4);
+		const Square rook_to = Square(mf == OO ? from + 1 : from - 1);
+		return k ^ zobrist::zobrist_table[pc][king_to]
+			^ zobrist::zobrist_table[rook][rook_from] ^ zobrist::zobrist_table[rook][rook_to];
+	}
+
+	if (mf & PR_KNIGHT) {
+		const PieceType promo = PieceType(KNIGHT + (mf & 0b11));
+		return k ^ zobrist::zobrist_table[make_piece(piece_color(pc), promo)][to];
+	}
+	return k ^ zobrist::zobrist_table[pc][to];
+}
+
 template<Color C>
 void PositionManager::play(const Move m) {
 	side_to_play = ~side_to_play;
 	++game_ply;
 	history[game_ply] = UndoInfo(history[game_ply - 1]);
+	history[game_ply].move = m;
+	history[game_ply].moved = board[m.from()];
 	PieceType movedPt = piece_type(board[m.from()]);
 	MoveFlags mf = m.flags();
 	bool isCapture = (mf & CAPTURE) != 0 || mf == EN_PASSANT;
@@ -240,6 +359,99 @@ void PositionManager::play(const Move m) {
 
 		break;
 	}
+
+	set_check_info<~C>();
+}
+
+template<Color Us>
+void PositionManager::set_check_info() {
+	constexpr Color Them = ~Us;
+	UndoInfo& st = history[game_ply];
+
+	const Bitboard us_bb = all_pieces<Us>();
+	const Bitboard them_bb = all_pieces<Them>();
+	const Bitboard all = us_bb | them_bb;
+	const Square our_king = bsf(bitboard_of(Us, KING));
+	const Square their_king = bsf(bitboard_of(Them, KING));
+
+	Bitboard b, candidates;
+	Square s;
+
+	st.checkers = attacks<KNIGHT>(our_king, all) & bitboard_of(Them, KNIGHT)
+		| pawn_attacks<Us>(our_king) & bitboard_of(Them, PAWN);
+
+	// enemy sliders seeing our king through their own pieces check it with
+	// nothing in between and pin a lone piece of ours
+	candidates = attacks<ROOK>(our_king, them_bb) & orthogonal_sliders<Them>()
+		| attacks<BISHOP>(our_king, them_bb) & diagonal_sliders<Them>();
+
+	st.pinned = 0;
+	while (candidates) {
+		s = pop_lsb(&candidates);
+		b = SQUARES_BETWEEN_BB[our_king][s] & us_bb;
+
+		if (b == 0) st.checkers ^= SQUARE_BB[s];
+		else if ((b & b - 1) == 0) st.pinned ^= b;
+	}
+
+	// the same from the enemy king: a lone piece of ours in front of one of
+	// our sliders uncovers check when it leaves the line
+	candidates = attacks<ROOK>(their_king, them_bb) & orthogonal_sliders<Us>()
+		| attacks<BISHOP>(their_king, them_bb) & diagonal_sliders<Us>();
+
+	st.discoverers = 0;
+	while (candidates) {
+		s = pop_lsb(&candidates);
+		b = SQUARES_BETWEEN_BB[their_king][s] & all;
+
+		if (b && (b & b - 1) == 0 && (b & us_bb)) st.discoverers |= b;
+	}
+
+	st.check_squares[PAWN] = pawn_attacks<Them>(their_king);
+	st.check_squares[KNIGHT] = attacks<KNIGHT>(their_king, all);
+	st.check_squares[BISHOP] = attacks<BISHOP>(their_king, all);
+	st.check_squares[ROOK] = attacks<ROOK>(their_king, all);
+	st.check_squares[QUEEN] = st.check_squares[BISHOP] | st.check_squares[ROOK];
+	st.check_squares[KING] = 0;
+}
+
+template<Color Us>
+bool PositionManager::gives_check(const Move m) const {
+	const UndoInfo& st = history[game_ply];
+	const Square from = m.from(), to = m.to();
+	const MoveFlags mf = m.flags();
+	const Square their_king = bsf(bitboard_of(~Us, KING));
+	const Bitboard all = all_pieces<WHITE>() | all_pieces<BLACK>();
+
+	// only the rook can check, from its square next to the king's
+	if (mf == OO || mf == OOO) {
+		const Square king_to = Square(mf == OO ? from + 2 : from - 2);
+		const Square rook_from = Square(mf == OO ? from + 3 : from - 4);
+		const Square rook_to = Square(mf == OO ? from + 1 : from - 1);
+		const Bitboard occ = (all ^ SQUARE_BB[from] ^ SQUARE_BB[rook_from])
+			| SQUARE_BB[king_to] | SQUARE_BB[rook_to];
+		return (attacks<ROOK>(rook_to, occ) & SQUARE_BB[their_king]) != 0;
+	}
+
+	if (!(mf & PR_KNIGHT) && (st.check_squares[piece_type(board[from])] & SQUARE_BB[to]))
+		return true;
+
+	if ((st.discoverers & SQUARE_BB[from]) && !(LINE[from][their_king] & SQUARE_BB[to]))
+		return true;
+
+	if (mf & PR_KNIGHT) {
+		const PieceType promo = PieceType(KNIGHT + (mf & 0b11));
+		return (attacks(promo, to, all ^ SQUARE_BB[from]) & SQUARE_BB[their_king]) != 0;
+	}
+
+	// the captured pawn can be a second piece on a line to the king
+	if (mf == EN_PASSANT) {
+		const Bitboard occ = (all ^ SQUARE_BB[from] ^ SQUARE_BB[to + relative_dir<Us>(SOUTH)])
+			| SQUARE_BB[to];
+		return ((attacks<ROOK>(their_king, occ) & orthogonal_sliders<Us>())
+			| (attacks<BISHOP>(their_king, occ) & diagonal_sliders<Us>())) != 0;
+	}
+	return false;
 }
 
 template<Color C>
@@ -299,9 +511,12 @@ void PositionManager::undo(const Move m) {
 	--game_ply;
 }
 
-template<Color Us>
+template<Color Us, GenType Type>
 Move* PositionManager::generate_legals(Move* list) {
 	constexpr Color Them = ~Us;
+	constexpr bool gen_captures = Type != GEN_QUIETS;
+	constexpr bool gen_quiets = Type != GEN_CAPTURES;
+	Move* const first = list;
 
 	const Bitboard us_bb = all_pieces<Us>();
 	const Bitboard them_bb = all_pieces<Them>();
@@ -331,30 +546,20 @@ Move* PositionManager::generate_legals(Move* list) {
 	while (b1) danger |= attacks<ROOK>(pop_lsb(&b1), all ^ SQUARE_BB[our_king]);
 
 	b1 = attacks<KING>(our_king, all) & ~(us_bb | danger);
-	list = make<QUIET>(our_king, b1 & ~them_bb, list);
-	list = make<CAPTURE>(our_king, b1 & them_bb, list);
+	if constexpr (gen_quiets) list = make<QUIET>(our_king, b1 & ~them_bb, list);
+	if constexpr (gen_captures) list = make<CAPTURE>(our_king, b1 & them_bb, list);
 
 	Bitboard capture_mask;
 	Bitboard quiet_mask;
 
 	Square s;
-	checkers = attacks<KNIGHT>(our_king, all) & bitboard_of(Them, KNIGHT)
-		| pawn_attacks<Us>(our_king) & bitboard_of(Them, PAWN);
-
-	Bitboard candidates = attacks<ROOK>(our_king, them_bb) & their_orth_sliders
-		| attacks<BISHOP>(our_king, them_bb) & their_diag_sliders;
-
-	pinned = 0;
-	while (candidates) {
-		s = pop_lsb(&candidates);
-		b1 = SQUARES_BETWEEN_BB[our_king][s] & us_bb;
-
-		if (b1 == 0) checkers ^= SQUARE_BB[s];
-		else if ((b1 & b1 - 1) == 0) pinned ^= b1;
-	}
-
+	const Bitboard checkers = history[game_ply].checkers;
+	const Bitboard pinned = history[game_ply].pinned;
 	const Bitboard not_pinned = ~pinned;
 
+	if constexpr (Type == GEN_EVASIONS)
+		if (!checkers) return first;
+
 	switch (sparse_pop_count(checkers)) {
 	case 2:
 		return list;
@@ -364,12 +569,14 @@ Move* PositionManager::generate_legals(Move* list) {
 
 		switch (board[checker_square]) {
 		case make_piece(Them, PAWN):
+			if constexpr (!gen_captures) return list;
 
 			if (checkers == shift<relative_dir<Us>(SOUTH)>(SQUARE_BB[history[game_ply].epsq])) {
 				b1 = pawn_attacks<Them>(history[game_ply].epsq) & bitboard_of(Us, PAWN) & not_pinned;
 				while (b1) *list++ = Move(pop_lsb(&b1), history[game_ply].epsq, EN_PASSANT);
 			}
 		case make_piece(Them, KNIGHT):
+			if constexpr (!gen_captures) return list;
 
 			b1 = attackers_from<Us>(checker_square, all) & not_pinned;
 			while (b1) *list++ = Move(pop_lsb(&b1), checker_square, CAPTURE);
@@ -390,7 +597,7 @@ Move* PositionManager::generate_legals(Move* list) {
 
 		quiet_mask = ~all;
 
-		if (history[game_ply].epsq != NO_SQ) {
+		if (gen_captures && history[game_ply].epsq != NO_SQ) {
 			b2 = pawn_attacks<Them>(history[game_ply].epsq) & bitboard_of(Us, PAWN);
 			b1 = b2 & not_pinned;
 			while (b1) {
@@ -409,18 +616,20 @@ Move* PositionManager::generate_legals(Move* list) {
 			}
 		}
 
-		if (!((history[game_ply].entry & oo_mask<Us>()) | ((all | danger) & oo_blockers_mask<Us>())))
-			*list++ = Us == WHITE ? Move(E1, H1, OO) : Move(E8, H8, OO);
-		if (!((history[game_ply].entry & ooo_mask<Us>()) |
-			((all | (danger & ~ignore_ooo_danger<Us>())) & ooo_blockers_mask<Us>())))
-			*list++ = Us == WHITE ? Move(E1, C1, OOO) : Move(E8, C8, OOO);
+		if constexpr (gen_quiets) {
+			if (!((history[game_ply].entry & oo_mask<Us>()) | ((all | danger) & oo_blockers_mask<Us>())))
+				*list++ = Us == WHITE ? Move(E1, H1, OO) : Move(E8, H8, OO);
+			if (!((history[game_ply].entry & ooo_mask<Us>()) |
+				((all | (danger & ~ignore_ooo_danger<Us>())) & ooo_blockers_mask<Us>())))
+				*list++ = Us == WHITE ? Move(E1, C1, OOO) : Move(E8, C8, OOO);
+		}
 
 		b1 = ~(not_pinned | bitboard_of(Us, KNIGHT));
 		while (b1) {
 			s = pop_lsb(&b1);
 			b2 = attacks(piece_type(board[s]), s, all) & LINE[our_king][s];
-			list = make<QUIET>(s, b2 & quiet_mask, list);
-			list = make<CAPTURE>(s, b2 & capture_mask, list);
+			if constexpr (gen_quiets) list = make<QUIET>(s, b2 & quiet_mask, list);
+			if constexpr (gen_captures) list = make<CAPTURE>(s, b2 & capture_mask, list);
 		}
 
 		b1 = ~not_pinned & bitboard_of(Us, PAWN);
@@ -430,17 +639,19 @@ Move* PositionManager::generate_legals(Move* list) {
 			if (rank_of(s) == relative_rank<Us>(RANK7)) {
 
 				b2 = pawn_attacks<Us>(s) & capture_mask & LINE[our_king][s];
-				list = make<PROMOTION_CAPTURES>(s, b2, list);
+				if constexpr (gen_captures) list = make<PROMOTION_CAPTURES>(s, b2, list);
 			}
 			else {
 				b2 = pawn_attacks<Us>(s) & them_bb & LINE[s][our_king];
-				list = make<CAPTURE>(s, b2, list);
+				if constexpr (gen_captures) list = make<CAPTURE>(s, b2, list);
 
 				b2 = shift<relative_dir<Us>(NORTH)>(SQUARE_BB[s]) & ~all & LINE[our_king][s];
 				b3 = shift<relative_dir<Us>(NORTH)>(b2 &
 					MASK_RANK[relative_rank<Us>(RANK3)]) & ~all & LINE[our_king][s];
-				list = make<QUIET>(s, b2, list);
-				list = make<DOUBLE_PUSH>(s, b3, list);
+				if constexpr (gen_quiets) {
+					list = make<QUIET>(s, b2, list);
+					list = make<DOUBLE_PUSH>(s, b3, list);
+				}
 			}
 		}
 		break;
@@ -450,24 +661,24 @@ Move* PositionManager::generate_legals(Move* list) {
 	while (b1) {
 		s = pop_lsb(&b1);
 		b2 = attacks<KNIGHT>(s, all);
-		list = make<QUIET>(s, b2 & quiet_mask, list);
-		list = make<CAPTURE>(s, b2 & capture_mask, list);
+		if constexpr (gen_quiets) list = make<QUIET>(s, b2 & quiet_mask, list);
+		if constexpr (gen_captures) list = make<CAPTURE>(s, b2 & capture_mask, list);
 	}
 
 	b1 = our_diag_sliders & not_pinned;
 	while (b1) {
 		s = pop_lsb(&b1);
 		b2 = attacks<BISHOP>(s, all);
-		list = make<QUIET>(s, b2 & quiet_mask, list);
-		list = make<CAPTURE>(s, b2 & capture_mask, list);
+		if constexpr (gen_quiets) list = make<QUIET>(s, b2 & quiet_mask, list);
+		if constexpr (gen_captures) list = make<CAPTURE>(s, b2 & capture_mask, list);
 	}
 
 	b1 = our_orth_sliders & not_pinned;
 	while (b1) {
 		s = pop_lsb(&b1);
 		b2 = attacks<ROOK>(s, all);
-		list = make<QUIET>(s, b2 & quiet_mask, list);
-		list = make<CAPTURE>(s, b2 & capture_mask, list);
+		if constexpr (gen_quiets) list = make<QUIET>(s, b2 & quiet_mask, list);
+		if constexpr (gen_captures) list = make<CAPTURE>(s, b2 & capture_mask, list);
 	}
 
 	b1 = bitboard_of(Us, PAWN) & not_pinned & ~MASK_RANK[relative_rank<Us>(RANK7)];
@@ -478,40 +689,50 @@ Move* PositionManager::generate_legals(Move* list) {
 
 	b2 &= quiet_mask;
 
-	while (b2) {
-		s = pop_lsb(&b2);
-		*list++ = Move(s - relative_dir<Us>(NORTH), s, QUIET);
-	}
+	if constexpr (gen_quiets) {
+		while (b2) {
+			s = pop_lsb(&b2);
+			*list++ = Move(s - relative_dir<Us>(NORTH), s, QUIET);
+		}
 
-	while (b3) {
-		s = pop_lsb(&b3);
-		*list++ = Move(s - relative_dir<Us>(NORTH_NORTH), s, DOUBLE_PUSH);
+		while (b3) {
+			s = pop_lsb(&b3);
+			*list++ = Move(s - relative_dir<Us>(NORTH_NORTH), s, DOUBLE_PUSH);
+		}
 	}
 
-	b2 = shift<relative_dir<Us>(NORTH_WEST)>(b1) & capture_mask;
-	b3 = shift<relative_dir<Us>(NORTH_EAST)>(b1) & capture_mask;
+	if constexpr (gen_captures) {
+		b2 = shift<relative_dir<Us>(NORTH_WEST)>(b1) & capture_mask;
+		b3 = shift<relative_dir<Us>(NORTH_EAST)>(b1) & capture_mask;
 
-	while (b2) {
-		s = pop_lsb(&b2);
-		*list++ = Move(s - relative_dir<Us>(NORTH_WEST), s, CAPTURE);
-	}
+		while (b2) {
+			s = pop_lsb(&b2);
+			*list++ = Move(s - relative_dir<Us>(NORTH_WEST), s, CAPTURE);
+		}
 
-	while (b3) {
-		s = pop_lsb(&b3);
-		*list++ = Move(s - relative_dir<Us>(NORTH_EAST), s, CAPTURE);
+		while (b3) {
+			s = pop_lsb(&b3);
+			*list++ = Move(s - relative_dir<Us>(NORTH_EAST), s, CAPTURE);
+		}
 	}
 
 	b1 = bitboard_of(Us, PAWN) & not_pinned & MASK_RANK[relative_rank<Us>(RANK7)];
 	if (b1) {
+		// the queen push counts as a capture, the under-promotions as quiets
 		b2 = shift<relative_dir<Us>(NORTH)>(b1) & quiet_mask;
 		while (b2) {
 			s = pop_lsb(&b2);
-			*list++ = Move(s - relative_dir<Us>(NORTH), s, PR_KNIGHT);
-			*list++ = Move(s - relative_dir<Us>(NORTH), s, PR_BISHOP);
-			*list++ = Move(s - relative_dir<Us>(NORTH), s, PR_ROOK);
-			*list++ = Move(s - relative_dir<Us>(NORTH), s, PR_QUEEN);
+			if constexpr (gen_quiets) {
+				*list++ = Move(s - relative_dir<Us>(NORTH), s, PR_KNIGHT);
+				*list++ = Move(s - relative_dir<Us>(NORTH), s, PR_BISHOP);
+				*list++ = Move(s - relative_dir<Us>(NORTH), s, PR_ROOK);
+			}
+			if constexpr (gen_captures)
+				*list++ = Move(s - relative_dir<Us>(NORTH), s, PR_QUEEN);
 		}
 
+		if constexpr (!gen_captures) return list;
+
 		b2 = shift<relative_dir<Us>(NORTH_WEST)>(b1) & capture_mask;
 		b3 = shift<relative_dir<Us>(NORTH_EAST)>(b1) & capture_mask;
 
@@ -534,6 +755,111 @@ Move* PositionManager::generate_legals(Move* list) {
 
 	return list;
 }
+template<Color Us>
+bool PositionManager::is_pseudo_legal(const Move m) const {
+	constexpr Color Them = ~Us;
+	const Square from = m.from(), to = m.to();
+	const Piece pc = board[from];
+	const MoveFlags mf = m.flags();
+
+	if (from == to || pc == NO_PIECE || piece_color(pc) != Us) return false;
+
+	const Bitboard all = all_pieces<WHITE>() | all_pieces<BLACK>();
+
+	if (mf == OO || mf == OOO) {
+		constexpr Square king_from = Us == WHITE ? E1 : E8;
+		if (pc != make_piece(Us, KING) || from != king_from) return false;
+
+		// generate_legals encodes short castling as e1h1 and long as e1c1
+		Bitboard path;
+		if (mf == OO) {
+			if (to != (Us == WHITE ? H1 : H8) || (history[game_ply].entry & oo_mask<Us>()) ||
+				(all & oo_blockers_mask<Us>())) return false;
+			path = oo_blockers_mask<Us>();
+		} else {
+			if (to != (Us == WHITE ? C1 : C8) || (history[game_ply].entry & ooo_mask<Us>()) ||
+				(all & ooo_blockers_mask<Us>())) return false;
+			path = ooo_blockers_mask<Us>() & ~ignore_ooo_danger<Us>();
+		}
+
+		// neither out of, through nor into check
+		path |= SQUARE_BB[from];
+		while (path) {
+			const Square s = pop_lsb(&path);
+			if (attackers_from<Them>(s, all) | (attacks<KING>(s, all) & bitboard_of(Them, KING)))
+				return false;
+		}
+		return true;
+	}
+
+	const Piece target = board[to];
+
+	if (mf == EN_PASSANT)
+		return piece_type(pc) == PAWN && to == history[game_ply].epsq &&
+			(pawn_attacks<Us>(from) & SQUARE_BB[to]);
+
+	if (mf & CAPTURE) {
+		if (target == NO_PIECE || piece_color(target) != Them || piece_type(target) == KING)
+			return false;
+	} else if (target != NO_PIECE) {
+		return false;
+	}
+
+	if (piece_type(pc) != PAWN)
+		return (mf == QUIET || mf == CAPTURE) &&
+			(attacks(piece_type(pc), from, all) & SQUARE_BB[to]);
+
+	// a pawn move promotes exactly when it reaches the last rank
+	const bool promotion = (mf & PR_KNIGHT) != 0;
+	if ((rank_of(to) == relative_rank<Us>(RANK8)) != promotion) return false;
+
+	switch (mf) {
+	case QUIET:
+	case PR_KNIGHT:
+	case PR_BISHOP:
+	case PR_ROOK:
+	case PR_QUEEN:
+		return to == from + relative_dir<Us>(NORTH);
+	case DOUBLE_PUSH:
+		return rank_of(from) == relative_rank<Us>(RANK2) &&
+			to == from + relative_dir<Us>(NORTH_NORTH) &&
+			board[from + relative_dir<Us>(NORTH)] == NO_PIECE;
+	case CAPTURE:
+	case PC_KNIGHT:
+	case PC_BISHOP:
+	case PC_ROOK:
+	case PC_QUEEN:
+		return (pawn_attacks<Us>(from) & SQUARE_BB[to]) != 0;
+	default:
+		return false;
+	}
+}
+
+template<Color Us>
+bool PositionManager::is_legal(const Move m) const {
+	constexpr Color Them = ~Us;
+	if (!is_pseudo_legal<Us>(m)) return false;
+
+	const MoveFlags mf = m.flags();
+	// is_pseudo_legal has already checked every square the king crosses
+	if (mf == OO || mf == OOO) return true;
+
+	const Square from = m.from(), to = m.to();
+	const Square ksq = piece_type(board[from]) == KING ? to : bsf(bitboard_of(Us, KING));
+
+	// the board after the move, with the captured piece no longer attacking
+	Bitboard occ = ((all_pieces<WHITE>() | all_pieces<BLACK>()) ^ SQUARE_BB[from]) | SQUARE_BB[to];
+	Bitboard gone = SQUARE_BB[to];
+	if (mf == EN_PASSANT) {
+		const Square cap = to + relative_dir<Us>(SOUTH);
+		occ ^= SQUARE_BB[cap];
+		gone |= SQUARE_BB[cap];
+	}
+
+	return !((attackers_from<Them>(ksq, occ) |
+		(attacks<KING>(ksq, occ) & bitboard_of(Them, KING))) & ~gone);
+}
+
 template<Color Us>
 class MoveList {
 public:
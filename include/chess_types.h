@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdint>
 #include <algorithm>
+#include <bit>
 #include <cmath>
 #include <iostream>
 #include <ostream>
@@ -100,18 +101,49 @@ extern const Bitboard SQUARE_BB[65];
 
 extern void print_bitboard(Bitboard b);
 
-extern const Bitboard k1;
-extern const Bitboard k2;
-extern const Bitboard k4;
-extern const Bitboard kf;
+constexpr Bitboard k1 = 0x5555555555555555;
+constexpr Bitboard k2 = 0x3333333333333333;
+constexpr Bitboard k4 = 0x0f0f0f0f0f0f0f0f;
+constexpr Bitboard kf = 0x0101010101010101;
+
+// bit counting is inlined into the move generator and eval. std::popcount is
+// only a win when the target has a popcount instruction (-march=x86-64-v2 and
+// up, or any aarch64); otherwise it becomes a library call and the SWAR count
+// is faster. countr_zero lowers to TZCNT/BSF or RBIT+CLZ on every target.
+#if defined(__POPCNT__) || defined(__aarch64__) || (defined(_MSC_VER) && defined(__AVX__))
+#define HW_POPCOUNT 1
+#endif
+
+inline int pop_count(Bitboard x) {
+#ifdef HW_POPCOUNT
+	return std::popcount(x);
+#else
+	x = x - ((x >> 1) & k1);
+	x = (x & k2) + ((x >> 2) & k2);
+	x = (x + (x >> 4)) & k4;
+	return static_cast<int>((x * kf) >> 56);
+#endif
+}
+
+// for boards with only a few bits set
+inline int sparse_pop_count(Bitboard x) {
+#ifdef HW_POPCOUNT
+	return std::popcount(x);
+#else
+	int count = 0;
+	for (; x; x &= x - 1) count++;
+	return count;
+#endif
+}
 
-extern int pop_count(Bitboard x);
-extern int sparse_pop_count(Bitboard x);
-extern Square pop_lsb(Bitboard* b);
+inline Square bsf(Bitboard b) { return Square(std::countr_zero(b)); }
 
-extern const int DEBRUIJN64[64];
-extern const Bitboard MAGIC;
-extern Square bsf(Bitboard b);
+// x & (x - 1) is a single BLSR with BMI
+inline Square pop_lsb(Bitboard* b) {
+	Square s = bsf(*b);
+	*b &= *b - 1;
+	return s;
+}
 
 constexpr Rank rank_of(Square s) { return Rank(s >> 3); }
 constexpr File file_of(Square s) { return File(s & 0b111); }
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "engine.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// in-process searching for programs that link chessgs_core. A context is
+// one engine with its own game; contexts built on one table share it, so a
+// service can run many of them on their own threads against a single large
+// hash. A context is used from one thread at a time, except for stop().
+
+class SearchContext {
+public:
+  // a table of mb megabytes to hand to several contexts
+  static std::shared_ptr<TranspositionTable> makeTable(int mb);
+
+  // with no table the context gets its own of DEFAULT_HASH_MB
+  explicit SearchContext(std::shared_ptr<TranspositionTable> table = nullptr);
+
+  // see ChessEngine::setPosition
+  bool setPosition(const std::string &fen,
+                   const std::vector<std::string> &moves = {});
+  // lazy smp threads for this context's searches
+  void setThreads(int n) { engine->setThreads(n); }
+  // loads an NNUE network and evaluates with it from then on
+  bool loadNetwork(const std::string &path);
+
+  SearchResult search(const SearchLimits &limits);
+  // ends a running search early; safe from any thread
+  void stop() { engine->stop(); }
+
+private:
+  std::unique_ptr<ChessEngine> engine;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+/* C interface to SearchContext (chessgs.h) for callers that cannot use
+ * C++. Functions returning int give 1 on success and 0 on failure; none
+ * of them throw. */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CGS_MAX_MOVES 256
+#define CGS_MAX_PV 64
+/* a UCI move and its terminating zero */
+#define CGS_MOVE_CHARS 6
+
+enum { CGS_BOUND_EXACT = 0, CGS_BOUND_LOWER = 1, CGS_BOUND_UPPER = 2 };
+
+typedef struct cgs_table cgs_table;
+typedef struct cgs_context cgs_context;
+
+/* zero means no limit, as in SearchLimits */
+typedef struct {
+  int depth;
+  uint64_t nodes;
+  int time_ms;
+} cgs_limits;
+
+typedef struct {
+  char move[CGS_MOVE_CHARS];
+  int score;
+  int bound;
+} cgs_root_move;
+
+typedef struct {
+  char best_move[CGS_MOVE_CHARS];
+  int score;
+  int bound;
+  int depth;
+  uint64_t nodes;
+  uint32_t time_ms;
+  int pv_length;
+  char pv[CGS_MAX_PV][CGS_MOVE_CHARS];
+  int num_root_moves;
+  cgs_root_move root_moves[CGS_MAX_MOVES];
+} cgs_result;
+
+/* a hash table to share between contexts. It stays alive until it and
+ * every context built on it have been freed, in any order. */
+cgs_table *cgs_table_new(int hash_mb);
+void cgs_table_free(cgs_table *table);
+
+/* table may be NULL for a context with its own table */
+cgs_context *cgs_context_new(cgs_table *table);
+void cgs_context_free(cgs_context *ctx);
+
+/* fen NULL for the starting position; moves NULL or space-separated UCI.
+ * 0 for a malformed or illegal fen, which leaves the starting position, or
+ * for an illegal move, which leaves the moves before it played. */
+int cgs_set_position(cgs_context *ctx, const char *fen, const char *moves);
+int cgs_set_threads(cgs_context *ctx, int threads);
+int cgs_load_network(cgs_context *ctx, const char *path);
+
+int cgs_search(cgs_context *ctx, const cgs_limits *limits, cgs_result *out);
+/* safe to call from another thread while cgs_search runs */
+void cgs_stop(cgs_context *ctx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -2,14 +2,23 @@
 
 #include "bitboard.h"
 #include "chess_types.h"
-#include <SDL3/SDL.h>
+#include "nnue.h"
+#include "perft.h"
+#include "tt.h"
 #include <atomic>
+#include <functional>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
+// milliseconds on the steady clock since the program started. Wraps after
+// about 49 days, so time spans are taken as unsigned differences.
+uint32_t now_ms();
+
 struct Score {
   int mg;
   int eg;
@@ -35,20 +44,22 @@ struct Score {
   Score operator/(int value) const { return Score(mg / value, eg / value); }
 };
 
-struct ScoredMove {
-  Move move;
-  int score;
+// pawn structure is a function of the pawns alone, so it is cached by the
+// pawn zobrist key. A zeroed slot is exactly the entry for a pawnless board.
+struct PawnEntry {
+  uint64_t key;
+  Score score[NCOLORS];
 };
 
-enum TTBound : uint8_t { TT_EXACT = 0, TT_LOWER = 1, TT_UPPER = 2 };
+#define PAWN_TABLE_SIZE (1 << 14)
 
-struct TTEntry {
-  uint64_t key;
-  Move bestMove;
-  int16_t score;
-  int8_t depth;
-  uint8_t bound;
-  uint8_t age;
+// direct-mapped static eval cache: each slot packs the high 48 bits of the
+// position key with the 16-bit eval
+#define EVAL_CACHE_SIZE (1 << 17)
+
+struct ScoredMove {
+  Move move;
+  int score;
 };
 
 struct OpeningBookMove {
@@ -62,7 +73,13 @@ struct OpeningBookMove {
 #define MAX_PLY 128
 #define MAX_Q_DEPTH 8
 #define MAX_B_DEPTH 64
+// a search never plays more than MAX_B_DEPTH + MAX_Q_DEPTH plies above its
+// root, so keeping MAX_PLY plies of history always covers the one running
+static_assert(MAX_B_DEPTH + MAX_Q_DEPTH <= MAX_PLY &&
+                  MAX_PLY < HISTORY_PLIES - 2,
+              "a search must fit in the ply history");
 #define MAX_MOVES 256
+#define MAX_THREADS 64
 
 struct AnalysisResult {
   int64_t nodes;
@@ -72,6 +89,54 @@ struct AnalysisResult {
   int score;
 };
 
+// a root move's score in the last completed iteration. Moves after the
+// first are searched with a null window, so most scores are upper bounds.
+struct RootMoveScore {
+  Move move;
+  int score;
+  TTBound bound;
+};
+
+// zero means no limit; with none set the search runs until stop()
+struct SearchLimits {
+  int depth = 0;
+  uint64_t nodes = 0; // nodes searched by the context's own thread
+  int time_ms = 0;
+};
+
+struct SearchResult {
+  struct RootMove {
+    std::string move;
+    int score;
+    TTBound bound;
+  };
+
+  // UCI moves; best_move is empty when the side to move has no legal move
+  std::string best_move;
+  std::vector<std::string> pv;
+  // centipawns for the side to move, exact unless the first iteration was
+  // cut short, in which case it is a lower bound
+  int score = 0;
+  TTBound bound = TT_EXACT;
+  int depth = 0;
+  uint64_t nodes = 0;
+  uint32_t time_ms = 0;
+  // every legal root move from the last completed iteration
+  std::vector<RootMove> root_moves;
+};
+
+// one position to analyse, see ChessEngine::runAnalysis
+struct AnalysisJob {
+  std::string fen;
+  SearchLimits limits;
+  // the caller's label, handed back untouched with the result
+  std::string id;
+};
+
+// the position at the start of an EPD or FEN line as a six-field FEN, or
+// "" if the line has fewer than four fields (analysis.cpp)
+std::string fen_from_epd(const std::string &line);
+
 struct SearchStatistics {
   int64_t nodes;
   int64_t qnodes;
@@ -81,6 +146,8 @@ struct SearchStatistics {
   int fail_high_first;
   int fail_high;
   int moves_searched;
+  int64_t eval_cache_hits;
+  int64_t eval_cache_misses;
 };
 
 struct MatchResult {
@@ -145,15 +212,29 @@ public:
 };
 
   ChessEngine();
+  // engines built on one table share it: the lazy smp helpers, and
+  // embedding contexts (chessgs.h). No opening book is loaded.
+  explicit ChessEngine(std::shared_ptr<TranspositionTable> sharedTT);
   ~ChessEngine();
 
   // setup
   void resetToStartingPosition();
+  // fen followed by UCI moves. False if the fen is malformed or not a legal
+  // position (see PositionManager::is_valid_fen, and the side not to move
+  // may not be in check), which leaves the starting position, or if a move
+  // is illegal, which leaves the moves before it played. The ep square and
+  // halfmove clock are kept.
+  bool setPosition(const std::string &fen,
+                   const std::vector<std::string> &moves = {});
   PieceType getPieceAt(Square sq, Color &color);
 
   // move gen
   std::vector<Move> generateLegalMoves();
   int generateLegalMovesInto(Move *buf);
+  // subsets of the legal moves, see GenType
+  int generateCapturesInto(Move *buf);
+  int generateQuietsInto(Move *buf);
+  int generateEvasionsInto(Move *buf);
   bool makeMove(const Move &move);
   void unmakeMove();
 
@@ -172,30 +253,52 @@ public:
   // formatting
   std::string moveToString(const Move &move) const;
   std::string moveToUCI(const Move &move) const;
+  // standard algebraic notation, check and mate suffixes included
+  std::string moveToSAN(const Move &move);
 
   const SearchProgress &progress() const { return search_progress; }
   std::vector<IterationInfo> drainIterationLog();
 
   void stop() { time_up_flag = true; }
 
+  // lazy smp: total search threads including this one
+  void setThreads(int n);
+  int getThreads() const { return num_threads; }
+  uint64_t totalNodes() const { return total_nodes; }
+
+  // transposition table size in megabytes (UCI Hash)
+  void setHashSize(int mb);
+  int getHashSize() const { return (int)tt->size_mb; }
+  bool saveHash(const std::string &path) const { return tt->save(path); }
+  bool loadHash(const std::string &path) { return tt->load(path, num_threads); }
+
   // evaluation (evaluation.cpp)
   Bitboard getFriendlyPieces(Color color) const;
   int eval();
+  int cachedEval();
   Score evaluate_color(Color color);
-  int count_material(Color color);
   int non_pawn_material(Color color);
   int game_phase();
-  Score evalPawns(Color color);
   Score evalKnights(Color color);
   Score evalBishops(Color color);
   Score evalRooks(Color color);
   Score evalQueens(Color color);
-  Score evalKing(Color color);
   Score evalPawnStructure(Color color);
+  const PawnEntry &probePawnTable();
+  void computePawnEntry(PawnEntry &entry);
   Score evalKingVulnerability(Color color);
   Score evalKnightMobility(Square sq, Color color, Bitboard poss);
   Score evalEndgameTerms(Color color); 
 
+  // nnue (evaluation.cpp): once a network is loaded and enabled it replaces
+  // eval() at the leaves
+  bool loadNetwork(const std::string &path);
+  void setUseNNUE(bool on);
+  bool usingNNUE() const { return use_nnue && network; }
+  int nnueEval();
+  // one loaded network can serve any number of engines
+  void setNetwork(std::shared_ptr<const NnueNetwork> net, bool enabled);
+
   // search (search.cpp)
   int search(int depth, int ply, int alpha, int beta, bool nullPrune,
              bool isPv);
@@ -203,9 +306,20 @@ public:
   int getCaptureScore(const Move &move);
   int see(const Move &move);
   Move getBestMove(int depth);
-  Move getBestMoveWithTime(int time_ms);
-  void orderMovesInto(const Move *moves, int n, int ply, Move ttMove,
-                      ScoredMove *out);
+  Move getBestMoveWithTime(int time_ms, int maxDepth = MAX_B_DEPTH);
+  // caps the main thread's nodes in later searches; 0 removes the cap
+  void setNodeLimit(uint64_t nodes) { node_limit = nodes; }
+  // a search of the current position within limits, as SearchContext runs
+  // it (chessgs.h)
+  SearchResult searchWithLimits(const SearchLimits &limits);
+  // results of the last search
+  int lastDepth() const { return last_search_depth; }
+  int lastScore() const { return last_score; }
+  TTBound lastBound() const { return last_bound; }
+  const std::vector<RootMoveScore> &rootScores() const { return root_scores; }
+  // best followed by the table's best replies, ending at a repetition, a
+  // missing or illegal entry, or maxLength moves
+  std::vector<Move> principalVariation(Move best, int maxLength);
   Move parseMoveString(const std::string &moveStr);
   void clearTables();
   void clearKillers();
@@ -219,13 +333,42 @@ public:
   Move resolvePolyglotMove(int from, int to, int promo);
   Move getOpeningBookMove();
 
-  // tools
+  // tools (analysis.cpp)
+  // searches the jobs on worker engines that share this engine's table and
+  // network, getThreads() search threads in all: one worker per job up to
+  // that many, the spare threads split among the workers as lazy smp.
+  // report(i, result) runs once per job in input order, one call at a time,
+  // as soon as every earlier job is done; a job whose fen setPosition
+  // rejects reports depth -1. It runs without the pool locked, so workers
+  // keep searching and taking jobs while it writes. Worker statistics are
+  // added to this engine's.
+  void runAnalysis(
+      const std::vector<AnalysisJob> &jobs,
+      const std::function<void(size_t, const SearchResult &)> &report);
+  // the same over a stream, one single-threaded worker per search thread:
+  // next_job fills in the next job or returns false at the end. It is called
+  // with the pool locked, and no more than window jobs are ever read but not
+  // yet reported, so memory stays flat however long the input.
+  void runAnalysis(
+      const std::function<bool(AnalysisJob &)> &next_job,
+      const std::function<void(size_t, const AnalysisJob &,
+                               const SearchResult &)> &report,
+      size_t window);
+  // appends acd, acn, ce, pm and pv operations (moves in UCI) to every
+  // position of an EPD or FEN file, writing the lines out in input order.
+  // Blank and # lines are dropped; unreadable positions are copied through
+  // unannotated and reported. False if either file cannot be opened or any
+  // position was unreadable.
+  bool annotateFile(const std::string &in_path, const std::string &out_path,
+                    const SearchLimits &limits);
   std::vector<AnalysisResult>
   runAnalysis(const std::vector<std::string> &positions,
               int time_per_position_ms);
   void resetSearchStats();
   void printSearchStats();
-  void perftDivide(int depth);
+  // per-root-move counts, the root moves shared across threads; hash_mb > 0
+  // adds a perft table of that size
+  void perftDivide(int depth, int threads = 1, int hash_mb = 0);
   uint64_t perft(int depth);
   void testPerft();
   MatchResult selfPlayGames(int games, int depth, bool useTimeControl,
@@ -234,12 +377,12 @@ public:
   void uciLoop();
 
 private:
+  // reads the killer and history tables (movepick.cpp)
+  friend class MovePicker;
+
   PositionManager position;
 
-  static constexpr size_t TT_SIZE = 1u << 22;
-  static constexpr size_t TT_MASK = TT_SIZE - 1;
-  std::vector<TTEntry> tt;
-  uint8_t tt_age; 
+  std::shared_ptr<TranspositionTable> tt;
 
   void ttStore(uint64_t key, int depth, int score, TTBound bound, Move bestMove,
                int ply);
@@ -255,6 +398,20 @@ private:
 
   std::vector<OpeningBookMove> openingBook;
 
+  // UCI HashFile: default path for savehash/loadhash
+  std::string hash_file;
+
+  std::vector<PawnEntry> pawn_table;
+  std::vector<uint64_t> eval_cache;
+
+  // the network is shared with the helpers; accumulators are per engine,
+  // one per ply, valid where position.history[ply].nnue_computed says so
+  std::shared_ptr<const NnueNetwork> network;
+  bool use_nnue;
+  std::vector<NnueAccumulator> nnue_stack;
+  void invalidateAccumulators();
+  void updateAccumulator(Color perspective);
+
   int history_table[2][64][64];
   Move killer_moves[MAX_PLY][2];
 
@@ -265,15 +422,37 @@ private:
   uint64_t total_nodes;
   int last_search_depth;
   int last_score;
+  // exact unless the first iteration was cut short
+  TTBound last_bound;
+  std::vector<RootMoveScore> root_scores;
 
   // time control
-  Uint32 start_time;
+  uint32_t start_time;
   int allocated_time_ms;
-  bool time_up_flag;
+  uint64_t node_limit;
+  std::atomic<bool> time_up_flag;
+  // whether each search starts a new table generation. Analysis workers
+  // leave it to their pool, which ages the shared table once per round of
+  // jobs rather than once per worker search.
+  bool ages_tt = true;
   static constexpr int nodes_between_checks = 1024;
 
   SearchProgress search_progress;
 
   mutable std::mutex iteration_log_mutex;
   std::vector<IterationInfo> iteration_log;
+
+  // lazy smp (search.cpp)
+  Move iterativeDeepening(int maxDepth, int startDepth);
+  void startHelpers(int maxDepth);
+  void stopHelpers();
+  // runAnalysis on a given number of workers (analysis.cpp)
+  void runAnalysisPool(
+      int workers, const std::function<bool(AnalysisJob &)> &next_job,
+      const std::function<void(size_t, const AnalysisJob &,
+                               const SearchResult &)> &report,
+      size_t window);
+  int num_threads;
+  std::vector<std::unique_ptr<ChessEngine>> helpers;
+  std::vector<std::thread> helper_threads;
 };
\ No newline at end of file
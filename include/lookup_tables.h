@@ -1,5 +1,6 @@
 #pragma once
 #include "chess_types.h"
+#include <array>
 
 extern const Bitboard KING_ATTACKS[NSQUARES];
 extern const Bitboard KNIGHT_ATTACKS[NSQUARES];
@@ -9,35 +10,65 @@ extern const Bitboard BLACK_PAWN_ATTACKS[NSQUARES];
 extern Bitboard reverse(Bitboard b);
 extern Bitboard sliding_attacks(Square square, Bitboard occ, Bitboard mask);
 
-extern Bitboard get_rook_attacks_for_init(Square square, Bitboard occ);
-extern const Bitboard ROOK_MAGICS[NSQUARES];
-extern Bitboard ROOK_ATTACK_MASKS[NSQUARES];
-extern int ROOK_ATTACK_SHIFTS[NSQUARES];
-extern Bitboard ROOK_ATTACKS[NSQUARES][4096];
-extern void initialise_rook_attacks();
+// both slider tables live in one packed array: each square gets a slice of
+// exactly 2^(mask bits) entries at its own offset, 107648 entries (about
+// 840 KB) against 2.3 MB for fixed 4096/512-entry rows. BMI2 builds
+// (-march=x86-64-v3 or -mbmi2) index the slices with PEXT, everything else
+// with per-square magics and shifts. Define NO_PEXT for CPUs where PEXT is
+// microcoded (AMD before Zen 3).
+#if defined(__BMI2__) && !defined(NO_PEXT)
+#include <immintrin.h>
+#define USE_PEXT 1
+#define SLIDER_LOOKUP "pext"
+#else
+#define SLIDER_LOOKUP "fancy magic"
+#endif
 
-extern Bitboard get_rook_attacks(Square square, Bitboard occ);
-extern Bitboard get_xray_rook_attacks(Square square, Bitboard occ, Bitboard blockers);
+#define ROOK_TABLE_SIZE 102400
+#define BISHOP_TABLE_SIZE 5248
 
-extern Bitboard get_bishop_attacks_for_init(Square square, Bitboard occ);
-extern const Bitboard BISHOP_MAGICS[NSQUARES];
-extern Bitboard BISHOP_ATTACK_MASKS[NSQUARES];
-extern int BISHOP_ATTACK_SHIFTS[NSQUARES];
-extern Bitboard BISHOP_ATTACKS[NSQUARES][512];
-extern void initialise_bishop_attacks();
+// one square's slice of the packed slider table
+struct SliderSquare {
+	Bitboard mask;
+	Bitboard magic;
+	unsigned shift;
+	unsigned offset;
 
-extern Bitboard get_bishop_attacks(Square square, Bitboard occ);
-extern Bitboard get_xray_bishop_attacks(Square square, Bitboard occ, Bitboard blockers);
+	inline unsigned index(Bitboard occ) const {
+#ifdef USE_PEXT
+		return unsigned(_pext_u64(occ, mask));
+#else
+		return unsigned(((occ & mask) * magic) >> shift);
+#endif
+	}
+};
 
-extern Bitboard SQUARES_BETWEEN_BB[NSQUARES][NSQUARES];
-extern Bitboard LINE[NSQUARES][NSQUARES];
-extern Bitboard PAWN_ATTACKS[NCOLORS][NSQUARES];
-extern Bitboard PSEUDO_LEGAL_ATTACKS[NPIECE_TYPES][NSQUARES];
+template<size_t N>
+using BitboardTable = std::array<std::array<Bitboard, NSQUARES>, N>;
+
+// every table below is generated at compile time into read-only data, so
+// startup does no table work and concurrent processes share the pages
+extern const std::array<SliderSquare, NSQUARES> ROOK_SLIDERS;
+extern const std::array<SliderSquare, NSQUARES> BISHOP_SLIDERS;
+extern const std::array<Bitboard, ROOK_TABLE_SIZE + BISHOP_TABLE_SIZE> SLIDER_ATTACKS;
+
+inline Bitboard get_rook_attacks(Square square, Bitboard occ) {
+	const SliderSquare& s = ROOK_SLIDERS[square];
+	return SLIDER_ATTACKS[s.offset + s.index(occ)];
+}
+
+inline Bitboard get_bishop_attacks(Square square, Bitboard occ) {
+	const SliderSquare& s = BISHOP_SLIDERS[square];
+	return SLIDER_ATTACKS[s.offset + s.index(occ)];
+}
+
+extern Bitboard get_xray_rook_attacks(Square square, Bitboard occ, Bitboard blockers);
+extern Bitboard get_xray_bishop_attacks(Square square, Bitboard occ, Bitboard blockers);
 
-extern void initialise_squares_between();
-extern void initialise_line();
-extern void initialise_pseudo_legal();
-extern void initialise_all_databases();
+extern const BitboardTable<NSQUARES> SQUARES_BETWEEN_BB;
+extern const BitboardTable<NSQUARES> LINE;
+extern const BitboardTable<NCOLORS> PAWN_ATTACKS;
+extern const BitboardTable<NPIECE_TYPES> PSEUDO_LEGAL_ATTACKS;
 
 template<PieceType P>
 constexpr Bitboard attacks(Square s, Bitboard occ) {
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "engine.h"
+#include <string>
+
+// engine A against engine B, which may differ in their network. Games run
+// concurrently, each on its own pair of engines; every opening is played
+// twice with the colours swapped.
+struct MatchConfig {
+  int games = 100; // rounded up to a whole number of pairs
+  int concurrency = 1;
+  // an EPD or FEN file, a polyglot .bin book walked for the first
+  // MATCH_BOOK_PLIES, or empty for the starting position
+  std::string openings;
+  SearchLimits limits; // per move
+  int hash_mb = 16;    // per engine
+  // NNUE files; empty plays the classical eval
+  std::string network_a;
+  std::string network_b;
+  std::string pgn_path; // empty writes no PGN
+};
+
+#define MATCH_BOOK_PLIES 8
+
+// from A's side
+struct MatchScore {
+  int wins = 0;
+  int losses = 0;
+  int draws = 0;
+
+  int games() const { return wins + losses + draws; }
+  double score() const;
+  double elo() const;
+  // half the width of the 95% confidence interval on elo()
+  double eloError() const;
+  // likelihood of superiority: the chance A is the stronger engine
+  double los() const;
+};
+
+// plays the match, printing each game's result and the running score as
+// games finish. False if an opening, network or PGN file cannot be used.
+bool run_match(const MatchConfig &config);
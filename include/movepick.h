@@ -0,0 +1,61 @@
+#pragma once
+
+#include "engine.h"
+
+// hands out one node's moves best-first in stages: the TT move, captures
+// that do not lose material, killers, quiets by history, then losing
+// captures. The TT move and killers are checked for legality on their own,
+// captures and quiets are generated and scored only once the search reaches
+// them, and moves are chosen by selection, so a cutoff early in the list
+// leaves the rest ungenerated or unsorted. In check every evasion is
+// generated at once and goes through the same stages.
+class MovePicker {
+public:
+  MovePicker(ChessEngine &engine, int ply, Move ttMove, bool inCheck);
+
+  // the next move to search, or Move() once every legal move has been given
+  Move next();
+
+private:
+  enum Stage {
+    TT_MOVE,
+    GEN_CAPTURES,
+    GOOD_CAPTURES,
+    KILLERS,
+    GEN_QUIETS,
+    QUIETS,
+    BAD_CAPTURES,
+    DONE
+  };
+
+  ChessEngine &engine;
+  int ply;
+  Move ttMove;
+  Stage stage;
+
+  // captures and queen promotions first, then quiets. Losing captures are
+  // parked at the front of the capture range as the picker passes them.
+  ScoredMove moves[MAX_MOVES];
+  int num_captures;
+  int end;
+  int cur;
+  int bad_end;
+  bool in_check;
+  bool quiets_generated;
+
+  // killers already returned, kept out of the generated quiets
+  Move killers[2];
+  int num_killers;
+  int killer;
+
+  // files generated moves into the capture and quiet ranges, dropping moves
+  // already returned. Every capture must be added before the first quiet.
+  void add(Move *buf, int n);
+  bool returned(Move m) const;
+  void scoreCaptures();
+  void scoreQuiets();
+  // swaps the best-scored move in [cur, last) to cur and returns it
+  Move selectBest(int last);
+  // removes m from the quiet range if present
+  bool takeQuiet(Move m);
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "chess_types.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// HalfKP: every non-king piece is one input per perspective, indexed by that
+// side's king square. Black's view is mirrored vertically so both colours
+// share one set of weights.
+#define NNUE_PIECE_KINDS 10
+#define NNUE_INPUTS (NSQUARES * NNUE_PIECE_KINDS * NSQUARES)
+#define NNUE_HIDDEN 256
+
+// quantisation: accumulators are int16 and clipped to [0, NNUE_QA] before
+// the int8 output layer, whose weights carry a scale of NNUE_QB. The raw
+// output times NNUE_SCALE / (QA * QB) is centipawns.
+#define NNUE_QA 127
+#define NNUE_QB 64
+#define NNUE_SCALE 400
+// network output is clamped well clear of the mate range
+#define NNUE_MAX_EVAL 10000
+
+// largest number of feature changes a single move makes to one perspective
+#define NNUE_MAX_DELTA 3
+
+struct alignas(64) NnueAccumulator {
+  int16_t values[NCOLORS][NNUE_HIDDEN];
+};
+
+// the features one move adds and removes from one perspective
+struct NnueDelta {
+  int added[NNUE_MAX_DELTA];
+  int removed[NNUE_MAX_DELTA];
+  int num_added = 0;
+  int num_removed = 0;
+};
+
+// read-only after load, so one network is shared by every search thread
+struct NnueNetwork {
+  std::unique_ptr<int16_t[]> ft_weights; // [NNUE_INPUTS][NNUE_HIDDEN]
+  std::unique_ptr<int16_t[]> ft_bias;    // [NNUE_HIDDEN]
+  std::unique_ptr<int8_t[]> out_weights; // [2 * NNUE_HIDDEN], side to move first
+  int32_t out_bias = 0;
+
+  // file layout: NnueFileHeader, then the arrays above in order,
+  // little-endian
+  bool load(const std::string &path);
+
+  static int featureIndex(Color perspective, Square king, Piece pc, Square sq) {
+    if (perspective == BLACK) {
+      king = Square(king ^ 56);
+      sq = Square(sq ^ 56);
+    }
+    int kind = 2 * piece_type(pc) + (piece_color(pc) != perspective);
+    return (king * NNUE_PIECE_KINDS + kind) * NSQUARES + sq;
+  }
+
+  // acc = bias + the weight rows of the given features
+  void refresh(int16_t *acc, const int *features, int n) const;
+  // out = in + added rows - removed rows
+  void update(int16_t *out, const int16_t *in, const NnueDelta &d) const;
+  // side to move's accumulator first; returns centipawns for that side
+  int evaluate(const int16_t *us, const int16_t *them) const;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "bitboard.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// subtree counts keyed by position and remaining depth. A slot holds the
+// key xored with its data next to the data itself, so a slot torn by two
+// threads writing at once fails the key check instead of returning another
+// position's count.
+struct PerftSlot {
+  uint64_t check;
+  uint64_t data;
+};
+
+struct PerftTable {
+  std::unique_ptr<PerftSlot[]> slots;
+  size_t count = 0;
+
+  explicit PerftTable(size_t mb);
+
+  bool probe(uint64_t key, int depth, uint64_t &nodes) const;
+  void store(uint64_t key, int depth, uint64_t nodes);
+};
+
+struct PerftDivide {
+  Move move;
+  uint64_t nodes;
+};
+
+// leaf nodes depth plies below p. The last ply is counted from the size of
+// its move list rather than played.
+uint64_t perft(PositionManager &p, int depth, PerftTable *table = nullptr);
+
+// the same with the root moves shared out between threads. divide, if
+// given, receives each root move's count in generation order.
+uint64_t perft_parallel(const PositionManager &root, int depth, int threads,
+                        PerftTable *table = nullptr,
+                        std::vector<PerftDivide> *divide = nullptr);
+
+// runs an EPD perft file, one position per line as FEN ;D1 <count> ;D2 ...
+// Depths above max_depth (when > 0) are skipped. Positions are shared out
+// between threads and reported in file order as they finish. Returns false
+// if the file cannot be read, a line is not a position, or any count is wrong.
+bool run_perft_suite(const std::string &path, int threads, int max_depth = 0);
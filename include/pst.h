@@ -1,4 +1,5 @@
 #pragma once
+#include "chess_types.h"
 
 extern const int MG_PAWN_PST[64];
 extern const int EG_PAWN_PST[64];
@@ -11,4 +12,27 @@ extern const int EG_ROOK_PST[64];
 extern const int MG_QUEEN_PST[64];
 extern const int EG_QUEEN_PST[64];
 extern const int MG_KING_PST[64];
-extern const int EG_KING_PST[64];
\ No newline at end of file
+extern const int EG_KING_PST[64];
+
+constexpr int PAWN_VALUE = 100;
+constexpr int KNIGHT_VALUE = 300;
+constexpr int BISHOP_VALUE = 300;
+constexpr int ROOK_VALUE = 500;
+constexpr int QUEEN_VALUE = 900;
+
+constexpr int PHASE_KNIGHT = 1;
+constexpr int PHASE_BISHOP = 1;
+constexpr int PHASE_ROOK = 2;
+constexpr int PHASE_QUEEN = 4;
+constexpr int PHASE_MAX =
+    PHASE_KNIGHT * 4 + PHASE_BISHOP * 4 + PHASE_ROOK * 4 + PHASE_QUEEN * 2;
+
+// material + PST per piece and square, white positive and black negative,
+// so PositionManager can keep the running sum as pieces move. Material is
+// a middlegame-only term, as in the full evaluation.
+struct PsqTable {
+  int mg[NPIECES][NSQUARES];
+  int eg[NPIECES][NSQUARES];
+  int phase[NPIECES];
+};
+extern const PsqTable PSQ;
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "chess_types.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+enum TTBound : uint8_t { TT_EXACT = 0, TT_LOWER = 1, TT_UPPER = 2 };
+
+// 8 bytes: the low 16 key bits verify the slot (the high bits pick the
+// bucket), depth is stored +1 so a zeroed slot reads as empty, and the
+// search generation shares a byte with the bound.
+struct TTEntry {
+  uint16_t key16;
+  Move bestMove;
+  int16_t score;
+  uint8_t depth8;
+  uint8_t genBound;
+
+  int depth() const { return (int)depth8 - 1; }
+  TTBound bound() const { return TTBound(genBound & 0x3); }
+  uint8_t generation() const { return genBound >> 2; }
+  bool empty() const { return depth8 == 0; }
+
+  // an entry lives in the table as one word so it is read and written in a
+  // single access and can never be seen half-updated by another thread
+  uint64_t pack() const {
+    return (uint64_t)key16 | (uint64_t)bestMove.to_from() << 16 |
+           (uint64_t)(uint16_t)score << 32 | (uint64_t)depth8 << 48 |
+           (uint64_t)genBound << 56;
+  }
+  static TTEntry unpack(uint64_t w) {
+    TTEntry e;
+    e.key16 = (uint16_t)w;
+    e.bestMove = Move((uint16_t)(w >> 16));
+    e.score = (int16_t)(uint16_t)(w >> 32);
+    e.depth8 = (uint8_t)(w >> 48);
+    e.genBound = (uint8_t)(w >> 56);
+    return e;
+  }
+};
+
+#define TT_BUCKET_SIZE 8
+#define TT_GENERATIONS 64
+
+// one cache line per probe; slots are only touched through std::atomic_ref
+struct alignas(64) TTBucket {
+  uint64_t slots[TT_BUCKET_SIZE];
+};
+static_assert(sizeof(TTBucket) == 64, "TT buckets must fill one cache line");
+
+#define DEFAULT_HASH_MB 64
+#define MAX_HASH_MB 65536
+
+// one table shared by the main search and all lazy smp helpers
+struct TranspositionTable {
+  std::unique_ptr<TTBucket[]> buckets;
+  size_t count = 0;
+  size_t size_mb = 0;
+  // atomic because engines sharing the table each start their own searches
+  std::atomic<uint8_t> age{0};
+
+  // reallocates to the largest bucket count that fits in mb megabytes
+  void resize(size_t mb, int threads);
+  // zeroes the table, split across threads for multi-GB sizes
+  void clear(int threads);
+  void newSearch() { age = (age + 1) % TT_GENERATIONS; }
+
+  // snapshot to disk; load resizes to the saved size and rejects files
+  // written by another format version or zobrist seed
+  bool save(const std::string &path) const;
+  bool load(const std::string &path, int threads);
+
+  // copies out the entry for key, if the bucket holds one. probe and store
+  // are lock-free and may run concurrently from any number of threads.
+  bool probe(uint64_t key, TTEntry &out) const;
+  void store(uint64_t key, int depth, int score, TTBound bound, Move move);
+
+  // start pulling the bucket for key into cache ahead of the probe
+  void prefetch(uint64_t key) const {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(&bucket(key));
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch((const char *)&bucket(key), _MM_HINT_T0);
+#endif
+  }
+
+  // multiply-shift maps the key onto any bucket count, not just powers of two
+  TTBucket &bucket(uint64_t key) const {
+    return buckets[((key >> 32) * count) >> 32];
+  }
+};
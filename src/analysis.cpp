@@ -0,0 +1,296 @@
+#include "engine.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+static void add_stats(SearchStatistics &to, const SearchStatistics &s) {
+  to.nodes += s.nodes;
+  to.qnodes += s.qnodes;
+  to.hash_hits += s.hash_hits;
+  to.hash_used += s.hash_used;
+  to.null_prunes += s.null_prunes;
+  to.fail_high_first += s.fail_high_first;
+  to.fail_high += s.fail_high;
+  to.moves_searched += s.moves_searched;
+  to.eval_cache_hits += s.eval_cache_hits;
+  to.eval_cache_misses += s.eval_cache_misses;
+}
+
+void ChessEngine::runAnalysisPool(
+    int workers, const std::function<bool(AnalysisJob &)> &next_job,
+    const std::function<void(size_t, const AnalysisJob &,
+                             const SearchResult &)> &report,
+    size_t window) {
+  workers = std::max(1, workers);
+  window = std::max<size_t>(window, 1);
+
+  // jobs between being read and being reported live in a ring of window
+  // slots: slot i % window is free again once job i has been reported
+  struct Slot {
+    AnalysisJob job;
+    SearchResult result;
+    bool done = false;
+  };
+  std::vector<Slot> slots(window);
+  size_t read = 0, reported = 0;
+  bool input_done = false;
+  // set while one worker hands finished jobs to report(), which it does
+  // with the pool unlocked; the others leave their results to it
+  bool reporting = false;
+  std::mutex pool_mutex;
+  std::condition_variable room;
+
+  auto work = [&](int id) {
+    std::unique_ptr<ChessEngine> w(new ChessEngine(tt));
+    w->setNetwork(network, use_nnue);
+    w->setThreads(num_threads / workers + (id < num_threads % workers));
+    w->ages_tt = false;
+
+    std::unique_lock<std::mutex> lock(pool_mutex);
+    while (true) {
+      room.wait(lock, [&] { return input_done || read - reported < window; });
+      if (input_done)
+        break;
+      Slot &slot = slots[read % window];
+      if (!next_job(slot.job)) {
+        input_done = true;
+        room.notify_all();
+        break;
+      }
+      // a new generation per round of jobs: entries from searches still
+      // running elsewhere stay current instead of aging once per job
+      if (read % workers == 0)
+        tt->newSearch();
+      read++;
+      lock.unlock();
+
+      SearchResult r;
+      bool searched = w->setPosition(slot.job.fen);
+      if (searched)
+        r = w->searchWithLimits(slot.job.limits);
+      else
+        r.depth = -1;
+
+      lock.lock();
+      if (searched) {
+        add_stats(searchStats, w->searchStats);
+        total_nodes += w->total_nodes;
+      }
+      slot.result = std::move(r);
+      slot.done = true;
+      if (!reporting) {
+        reporting = true;
+        while (reported < read && slots[reported % window].done) {
+          Slot head = std::move(slots[reported % window]);
+          slots[reported % window] = Slot();
+          size_t i = reported++;
+          room.notify_all();
+          lock.unlock();
+          report(i, head.job, head.result);
+          lock.lock();
+        }
+        reporting = false;
+      }
+      room.notify_all();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int t = 1; t < workers; t++)
+    threads.emplace_back(work, t);
+  work(0);
+  for (std::thread &t : threads)
+    t.join();
+}
+
+void ChessEngine::runAnalysis(
+    const std::vector<AnalysisJob> &jobs,
+    const std::function<void(size_t, const SearchResult &)> &report) {
+  size_t next = 0;
+  runAnalysisPool(
+      (int)std::min<size_t>(num_threads, jobs.size()),
+      [&](AnalysisJob &job) {
+        if (next == jobs.size())
+          return false;
+        job = jobs[next++];
+        return true;
+      },
+      [&](size_t i, const AnalysisJob &, const SearchResult &r) {
+        report(i, r);
+      },
+      jobs.size());
+}
+
+void ChessEngine::runAnalysis(
+    const std::function<bool(AnalysisJob &)> &next_job,
+    const std::function<void(size_t, const AnalysisJob &,
+                             const SearchResult &)> &report,
+    size_t window) {
+  runAnalysisPool(num_threads, next_job, report, window);
+}
+
+std::vector<AnalysisResult>
+ChessEngine::runAnalysis(const std::vector<std::string> &positions,
+                         int time_per_position_ms) {
+  std::vector<AnalysisJob> jobs;
+  for (const std::string &fen : positions) {
+    AnalysisJob job;
+    job.fen = fen;
+    job.limits.time_ms = time_per_position_ms;
+    jobs.push_back(job);
+  }
+
+  std::vector<AnalysisResult> results(positions.size());
+  runAnalysis(jobs, [&results](size_t i, const SearchResult &r) {
+    results[i] = {(int64_t)r.nodes, (double)r.time_ms, r.depth, r.best_move,
+                  r.score};
+  });
+  return results;
+}
+
+// an EPD line is the first four FEN fields followed by operations; a FEN
+// line has the two move counters as well. Returns the number of leading
+// fields that make up the position, or 0 if there are not four.
+static int position_fields(const std::vector<std::string> &tokens) {
+  if (tokens.size() < 4)
+    return 0;
+  auto is_number = [](const std::string &t) {
+    return !t.empty() &&
+           t.find_first_not_of("0123456789") == std::string::npos;
+  };
+  if (tokens.size() >= 6 && is_number(tokens[4]) && is_number(tokens[5]))
+    return 6;
+  return 4;
+}
+
+std::string fen_from_epd(const std::string &line) {
+  std::istringstream iss(line);
+  std::vector<std::string> tokens;
+  for (std::string t; tokens.size() < 6 && iss >> t;)
+    tokens.push_back(t);
+  int fields = position_fields(tokens);
+  if (fields == 0)
+    return "";
+
+  std::string fen;
+  for (int i = 0; i < fields; i++)
+    fen += tokens[i] + (i + 1 < fields ? " " : "");
+  if (fields == 4)
+    fen += " 0 1";
+  return fen;
+}
+
+// io buffers for the annotation streams; multi-GB inputs are read and
+// written in blocks of this size
+#define ANNOTATE_BUFFER (1 << 20)
+
+bool ChessEngine::annotateFile(const std::string &in_path,
+                               const std::string &out_path,
+                               const SearchLimits &limits) {
+  std::vector<char> in_buf(ANNOTATE_BUFFER), out_buf(ANNOTATE_BUFFER);
+  std::ifstream in;
+  in.rdbuf()->pubsetbuf(in_buf.data(), in_buf.size());
+  in.open(in_path);
+  if (!in.is_open()) {
+    std::cerr << "Could not open input: " << in_path << std::endl;
+    return false;
+  }
+  std::ofstream out;
+  out.rdbuf()->pubsetbuf(out_buf.data(), out_buf.size());
+  out.open(out_path);
+  if (!out.is_open()) {
+    std::cerr << "Could not open output: " << out_path << std::endl;
+    return false;
+  }
+
+  size_t line_no = 0, unreadable = 0;
+  uint64_t nodes = 0;
+  auto start = std::chrono::steady_clock::now();
+
+  auto next_job = [&](AnalysisJob &job) {
+    std::string line;
+    while (std::getline(in, line)) {
+      line_no++;
+      if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+      size_t first = line.find_first_not_of(" \t");
+      if (first == std::string::npos || line[first] == '#')
+        continue;
+
+      job.fen = fen_from_epd(line);
+      job.limits = limits;
+      job.id = line;
+      return true;
+    }
+    return false;
+  };
+
+  auto report = [&](size_t i, const AnalysisJob &job, const SearchResult &r) {
+    std::string line = job.id;
+    line.erase(line.find_last_not_of(" \t") + 1);
+    std::istringstream iss(line);
+    std::vector<std::string> tokens;
+    for (std::string t; iss >> t;)
+      tokens.push_back(t);
+    // operations follow the position after a space and end in ';'
+    bool open_operation = (int)tokens.size() > position_fields(tokens) &&
+                          line.back() != ';';
+    if (r.depth < 0) {
+      std::cerr << in_path << ": position " << i + 1
+                << " could not be read" << std::endl;
+      unreadable++;
+      out << line << "\n";
+      return;
+    }
+
+    out << line << (open_operation ? "; " : " ") << "acd " << r.depth
+        << "; acn " << r.nodes << "; ce " << r.score << ";";
+    if (!r.best_move.empty()) {
+      out << " pm " << r.best_move << "; pv";
+      for (const std::string &m : r.pv)
+        out << " " << m;
+      out << ";";
+    }
+    out << "\n";
+
+    nodes += r.nodes;
+    if ((i + 1) % 1000 == 0) {
+      double secs = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+      std::cout << "annotated " << i + 1 << " positions, "
+                << (uint64_t)(secs > 0 ? (i + 1) / secs : 0) << " pos/s"
+                << std::endl;
+    }
+  };
+
+  // enough jobs in flight to keep every worker busy past one slow position
+  size_t annotated = 0;
+  runAnalysis(
+      next_job,
+      [&](size_t i, const AnalysisJob &job, const SearchResult &r) {
+        report(i, job, r);
+        annotated = i + 1;
+      },
+      (size_t)std::max(1, num_threads) * 16);
+  out.flush();
+
+  double secs =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+  std::cout << "Annotated " << annotated - unreadable << " of " << annotated
+            << " positions in " << secs << " s ("
+            << (uint64_t)(secs > 0 ? annotated / secs : 0) << " pos/s, "
+            << (uint64_t)(secs > 0 ? nodes / secs : 0) << " nps)"
+            << std::endl;
+  if (!out) {
+    std::cerr << "Could not write " << out_path << std::endl;
+    return false;
+  }
+  return unreadable == 0;
+}
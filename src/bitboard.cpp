@@ -1,21 +1,31 @@
 #include "bitboard.h"
 #include "lookup_tables.h"
+#include <algorithm>
 #include <sstream>
 
-uint64_t zobrist::zobrist_table[NPIECES][NSQUARES];
-uint64_t zobrist::zobrist_side;
-uint64_t zobrist::zobrist_ep[8];
+struct ZobristKeys {
+	std::array<std::array<uint64_t, NSQUARES>, NPIECES> table;
+	uint64_t side;
+	std::array<uint64_t, 8> ep;
+};
 
-void zobrist::initialise_zobrist_keys() {
+static constexpr ZobristKeys generate_zobrist_keys() {
+	ZobristKeys keys{};
 	PRNG rng(70026072);
 	for (int i = 0; i < NPIECES; i++)
 		for (int j = 0; j < NSQUARES; j++)
-			zobrist::zobrist_table[i][j] = rng.rand<uint64_t>();
-	zobrist::zobrist_side = rng.rand<uint64_t>();
+			keys.table[i][j] = rng.rand<uint64_t>();
+	keys.side = rng.rand<uint64_t>();
 	for (int i = 0; i < 8; i++)
-		zobrist::zobrist_ep[i] = rng.rand<uint64_t>();
+		keys.ep[i] = rng.rand<uint64_t>();
+	return keys;
 }
 
+static constexpr ZobristKeys ZOBRIST_KEYS = generate_zobrist_keys();
+constexpr std::array<std::array<uint64_t, NSQUARES>, NPIECES> zobrist::zobrist_table = ZOBRIST_KEYS.table;
+constexpr uint64_t zobrist::zobrist_side = ZOBRIST_KEYS.side;
+constexpr std::array<uint64_t, 8> zobrist::zobrist_ep = ZOBRIST_KEYS.ep;
+
 std::ostream& operator<< (std::ostream& os, const PositionManager& p) {
 	os << "\n+---+---+---+---+---+---+---+---+\n";
 	for (int rank = 7; rank >= 0; --rank) {
@@ -70,14 +80,67 @@ std::string PositionManager::fen() const {
 	return fen.str();
 }
 
+bool PositionManager::is_valid_fen(const std::string& fen) {
+	std::istringstream ss(fen);
+	std::string board, side, castling, ep, token;
+	if (!(ss >> board >> side >> castling >> ep)) return false;
+
+	// the board as piece letters from a1, '.' for an empty square
+	std::string squares(NSQUARES, '.');
+	int rank = 7, file = 0, white_kings = 0, black_kings = 0;
+	for (char ch : board) {
+		if (ch == '/') {
+			if (file != 8 || rank == 0) return false;
+			rank--;
+			file = 0;
+		} else if (ch >= '1' && ch <= '8') {
+			file += ch - '0';
+			if (file > 8) return false;
+		} else {
+			if (file == 8 || std::string("PNBRQKpnbrqk").find(ch) == std::string::npos)
+				return false;
+			if ((ch == 'P' || ch == 'p') && (rank == 0 || rank == 7)) return false;
+			white_kings += ch == 'K';
+			black_kings += ch == 'k';
+			squares[rank * 8 + file++] = ch;
+		}
+	}
+	if (rank != 0 || file != 8 || white_kings != 1 || black_kings != 1) return false;
+
+	if (side != "w" && side != "b") return false;
+
+	if (castling != "-") {
+		if (castling.size() > 4) return false;
+		for (size_t i = 0; i < castling.size(); i++)
+			if (std::string("KQkq").find(castling[i]) == std::string::npos ||
+				castling.find(castling[i], i + 1) != std::string::npos)
+				return false;
+	}
+
+	// an ep square is the one a pawn of the side not to move just skipped
+	if (ep != "-") {
+		const char ep_rank = side == "w" ? '6' : '3';
+		if (ep.size() != 2 || ep[0] < 'a' || ep[0] > 'h' || ep[1] != ep_rank) return false;
+		const int sq = (ep[1] - '1') * 8 + (ep[0] - 'a');
+		const int dir = side == "w" ? -8 : 8;
+		if (squares[sq] != '.' || squares[sq - dir] != '.' ||
+			squares[sq + dir] != (side == "w" ? 'p' : 'P'))
+			return false;
+	}
+
+	// the two clocks are optional, but numbers if they are there
+	for (int i = 0; i < 2 && ss >> token; i++)
+		if (token.find_first_not_of("0123456789") != std::string::npos) return false;
+	return !(ss >> token);
+}
+
 void PositionManager::set(const std::string& fen, PositionManager& p) {
 	for (int i = 0; i < NPIECES; i++) p.piece_bb[i] = 0;
 	for (int i = 0; i < NSQUARES; i++) p.board[i] = NO_PIECE;
 	p.hash = 0;
+	p.pawn_hash = 0;
 	p.game_ply = 0;
 	p.history[0] = UndoInfo();
-	p.checkers = 0;
-	p.pinned = 0;
 
 	int square = A8;
 	for (char ch : fen.substr(0, fen.find(' '))) {
@@ -90,15 +153,18 @@ void PositionManager::set(const std::string& fen, PositionManager& p) {
 	}
 
 	std::istringstream ss(fen.substr(fen.find(' ')));
-	unsigned char token;
+	std::string token;
 
 	ss >> token;
-	p.side_to_play = token == 'w' ? WHITE : BLACK;
+	p.side_to_play = token == "w" ? WHITE : BLACK;
 	if (p.side_to_play == BLACK) p.hash ^= zobrist::zobrist_side;
 
+	// the castling field is one token; reading it a char at a time would
+	// skip the space after it and run on into the ep square
 	p.history[p.game_ply].entry = ALL_CASTLING_MASK;
-	while (ss >> token && !isspace(token)) {
-		switch (token) {
+	ss >> token;
+	for (char ch : token) {
+		switch (ch) {
 		case 'K':
 			p.history[p.game_ply].entry &= ~WHITE_OO_MASK;
 			break;
@@ -114,7 +180,9 @@ void PositionManager::set(const std::string& fen, PositionManager& p) {
 		}
 	}
 
-	// parse en passant square if present
+	// parse en passant square if present. play() keeps the ep square out of
+	// the hash, so it stays out here too and a position set from a FEN hashes
+	// the same as one reached by the moves.
 	std::string ep_str;
 	ss >> ep_str;
 	if (ep_str.length() == 2 && ep_str[0] >= 'a' && ep_str[0] <= 'h'
@@ -122,7 +190,6 @@ void PositionManager::set(const std::string& fen, PositionManager& p) {
 		File f = File(ep_str[0] - 'a');
 		Rank r = Rank(ep_str[1] - '1');
 		p.history[p.game_ply].epsq = create_square(f, r);
-		p.hash ^= zobrist::zobrist_ep[f];
 	}
 	int hmc = 0;
 	ss >> hmc;
@@ -132,12 +199,33 @@ void PositionManager::set(const std::string& fen, PositionManager& p) {
 		p.history[p.game_ply].halfmove_clock = 0;
 		ss.clear();
 	}
+
+	// a board without both kings has no check info to speak of
+	if (p.bitboard_of(WHITE, KING) && p.bitboard_of(BLACK, KING))
+		p.set_check_info();
 }
 
 
+void PositionManager::drop_history(int keep) {
+	if (game_ply <= keep) return;
+	// assigned, not copy-constructed: UndoInfo's copy constructor starts
+	// the next ply rather than duplicating one
+	std::copy(history + game_ply - keep, history + game_ply + 1, history);
+	game_ply = keep;
+}
+
 void PositionManager::move_piece(Square from, Square to) {
 	hash ^= zobrist::zobrist_table[board[from]][from] ^ zobrist::zobrist_table[board[from]][to]
 		^ zobrist::zobrist_table[board[to]][to];
+	if (piece_type(board[from]) == PAWN)
+		pawn_hash ^= zobrist::zobrist_table[board[from]][from] ^ zobrist::zobrist_table[board[from]][to];
+	if (piece_type(board[to]) == PAWN)
+		pawn_hash ^= zobrist::zobrist_table[board[to]][to];
+	history[game_ply].psq_mg += PSQ.mg[board[from]][to] - PSQ.mg[board[from]][from]
+		- PSQ.mg[board[to]][to];
+	history[game_ply].psq_eg += PSQ.eg[board[from]][to] - PSQ.eg[board[from]][from]
+		- PSQ.eg[board[to]][to];
+	history[game_ply].phase -= PSQ.phase[board[to]];
 	Bitboard mask = SQUARE_BB[from] | SQUARE_BB[to];
 	piece_bb[board[from]] ^= mask;
 	piece_bb[board[to]] &= ~mask;
@@ -147,6 +235,10 @@ void PositionManager::move_piece(Square from, Square to) {
 
 void PositionManager::move_piece_quiet(Square from, Square to) {
 	hash ^= zobrist::zobrist_table[board[from]][from] ^ zobrist::zobrist_table[board[from]][to];
+	if (piece_type(board[from]) == PAWN)
+		pawn_hash ^= zobrist::zobrist_table[board[from]][from] ^ zobrist::zobrist_table[board[from]][to];
+	history[game_ply].psq_mg += PSQ.mg[board[from]][to] - PSQ.mg[board[from]][from];
+	history[game_ply].psq_eg += PSQ.eg[board[from]][to] - PSQ.eg[board[from]][from];
 	piece_bb[board[from]] ^= (SQUARE_BB[from] | SQUARE_BB[to]);
 	board[to] = board[from];
 	board[from] = NO_PIECE;
@@ -64,24 +64,6 @@ void print_bitboard(Bitboard b) {
 	std::cout << "\n";
 }
 
-const Bitboard k1 = 0x5555555555555555;
-const Bitboard k2 = 0x3333333333333333;
-const Bitboard k4 = 0x0f0f0f0f0f0f0f0f;
-const Bitboard kf = 0x0101010101010101;
-
-const int DEBRUIJN64[64] = {
-	0, 47,  1, 56, 48, 27,  2, 60,
-   57, 49, 41, 37, 28, 16,  3, 61,
-   54, 58, 35, 52, 50, 42, 21, 44,
-   38, 32, 29, 23, 17, 11,  4, 62,
-   46, 55, 26, 59, 40, 36, 15, 53,
-   34, 51, 20, 43, 31, 22, 10, 45,
-   25, 39, 14, 33, 19, 30,  9, 24,
-   13, 18,  8, 12,  7,  6,  5, 63
-};
-
-const Bitboard MAGIC = 0x03f79d71b4cb0a89;
-
 const char* MOVE_TYPESTR[16] = {
 	"", "", " O-O", " O-O-O", "N", "B", "R", "Q", " (capture)", "", " e.p.", "",
 	"N", "B", "R", "Q"
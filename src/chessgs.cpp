@@ -0,0 +1,28 @@
+#include "chessgs.h"
+#include <algorithm>
+
+std::shared_ptr<TranspositionTable> SearchContext::makeTable(int mb) {
+  auto table = std::make_shared<TranspositionTable>();
+  table->resize((size_t)std::max(1, std::min(mb, MAX_HASH_MB)), 1);
+  return table;
+}
+
+SearchContext::SearchContext(std::shared_ptr<TranspositionTable> table)
+    : engine(new ChessEngine(table ? std::move(table)
+                                   : makeTable(DEFAULT_HASH_MB))) {}
+
+bool SearchContext::setPosition(const std::string &fen,
+                                const std::vector<std::string> &moves) {
+  return engine->setPosition(fen, moves);
+}
+
+bool SearchContext::loadNetwork(const std::string &path) {
+  if (!engine->loadNetwork(path))
+    return false;
+  engine->setUseNNUE(true);
+  return true;
+}
+
+SearchResult SearchContext::search(const SearchLimits &limits) {
+  return engine->searchWithLimits(limits);
+}
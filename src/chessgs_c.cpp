@@ -0,0 +1,112 @@
+#include "chessgs_c.h"
+#include "chessgs.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+struct cgs_table {
+  std::shared_ptr<TranspositionTable> table;
+};
+
+struct cgs_context {
+  SearchContext context;
+};
+
+static void copy_move(char *dst, const std::string &move) {
+  size_t n = std::min(move.size(), (size_t)CGS_MOVE_CHARS - 1);
+  std::memcpy(dst, move.data(), n);
+  dst[n] = '\0';
+}
+
+cgs_table *cgs_table_new(int hash_mb) {
+  try {
+    return new cgs_table{SearchContext::makeTable(hash_mb)};
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void cgs_table_free(cgs_table *table) { delete table; }
+
+cgs_context *cgs_context_new(cgs_table *table) {
+  try {
+    return new cgs_context{
+        SearchContext(table ? table->table : nullptr)};
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void cgs_context_free(cgs_context *ctx) { delete ctx; }
+
+int cgs_set_position(cgs_context *ctx, const char *fen, const char *moves) {
+  if (!ctx)
+    return 0;
+  try {
+    std::vector<std::string> list;
+    if (moves) {
+      std::istringstream iss(moves);
+      for (std::string m; iss >> m;)
+        list.push_back(m);
+    }
+    return ctx->context.setPosition(fen ? fen : DEFAULT_FEN, list);
+  } catch (...) {
+    return 0;
+  }
+}
+
+int cgs_set_threads(cgs_context *ctx, int threads) {
+  if (!ctx)
+    return 0;
+  ctx->context.setThreads(threads);
+  return 1;
+}
+
+int cgs_load_network(cgs_context *ctx, const char *path) {
+  if (!ctx || !path)
+    return 0;
+  try {
+    return ctx->context.loadNetwork(path);
+  } catch (...) {
+    return 0;
+  }
+}
+
+int cgs_search(cgs_context *ctx, const cgs_limits *limits, cgs_result *out) {
+  if (!ctx || !out)
+    return 0;
+  try {
+    SearchLimits l;
+    if (limits) {
+      l.depth = limits->depth;
+      l.nodes = limits->nodes;
+      l.time_ms = limits->time_ms;
+    }
+    SearchResult r = ctx->context.search(l);
+
+    copy_move(out->best_move, r.best_move);
+    out->score = r.score;
+    out->bound = r.bound;
+    out->depth = r.depth;
+    out->nodes = r.nodes;
+    out->time_ms = r.time_ms;
+    out->pv_length = (int)std::min(r.pv.size(), (size_t)CGS_MAX_PV);
+    for (int i = 0; i < out->pv_length; i++)
+      copy_move(out->pv[i], r.pv[i]);
+    out->num_root_moves =
+        (int)std::min(r.root_moves.size(), (size_t)CGS_MAX_MOVES);
+    for (int i = 0; i < out->num_root_moves; i++) {
+      copy_move(out->root_moves[i].move, r.root_moves[i].move);
+      out->root_moves[i].score = r.root_moves[i].score;
+      out->root_moves[i].bound = r.root_moves[i].bound;
+    }
+    return 1;
+  } catch (...) {
+    return 0;
+  }
+}
+
+void cgs_stop(cgs_context *ctx) {
+  if (ctx)
+    ctx->context.stop();
+}
@@ -1,15 +1,24 @@
 #include "engine.h"
 #include "pst.h"
-#include <SDL3/SDL.h>
 #include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 
+static const std::chrono::steady_clock::time_point program_start =
+    std::chrono::steady_clock::now();
+
+uint32_t now_ms() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now() - program_start)
+      .count();
+}
+
 std::vector<ChessEngine::IterationInfo> ChessEngine::drainIterationLog() {
   std::lock_guard<std::mutex> lk(iteration_log_mutex);
   std::vector<IterationInfo> out;
@@ -17,15 +26,34 @@ std::vector<ChessEngine::IterationInfo> ChessEngine::drainIterationLog() {
   return out;
 }
 
-ChessEngine::ChessEngine() : tt(TT_SIZE) {
-  std::memset(tt.data(), 0, tt.size() * sizeof(TTEntry));
-  tt_age = 0;
+ChessEngine::ChessEngine()
+    : ChessEngine(std::make_shared<TranspositionTable>()) {
+  tt->resize(DEFAULT_HASH_MB, 1);
+
+  try {
+    if (std::ifstream("book.bin").good()) {
+      loadOpeningBook("book.bin");
+    } else {
+      openingBook.clear();
+    }
+  } catch (...) {
+    std::cerr << "Warning: Error loading opening book." << std::endl;
+    openingBook.clear();
+  }
+}
 
+ChessEngine::ChessEngine(std::shared_ptr<TranspositionTable> sharedTT)
+    : tt(std::move(sharedTT)), pawn_table(PAWN_TABLE_SIZE),
+      eval_cache(EVAL_CACHE_SIZE) {
+  num_threads = 1;
+  use_nnue = false;
   last_score = 0;
   total_nodes = 0;
   last_search_depth = 0;
+  last_bound = TT_EXACT;
   start_time = 0;
   allocated_time_ms = 0;
+  node_limit = 0;
   time_up_flag = false;
 
   std::memset(history_table, 0, sizeof(history_table));
@@ -37,17 +65,6 @@ ChessEngine::ChessEngine() : tt(TT_SIZE) {
   resetSearchStats();
 
   resetToStartingPosition();
-
-  try {
-    if (std::ifstream("book.bin").good()) {
-      loadOpeningBook("book.bin");
-    } else {
-      openingBook.clear();
-    }
-  } catch (...) {
-    std::cerr << "Warning: Error loading opening book." << std::endl;
-    openingBook.clear();
-  }
 }
 
 ChessEngine::~ChessEngine() {}
@@ -59,6 +76,32 @@ void ChessEngine::resetToStartingPosition() {
   repetition_history.push_back(position.get_hash());
 }
 
+bool ChessEngine::setPosition(const std::string &fen,
+                              const std::vector<std::string> &moves) {
+  // set() trusts its input, so nothing malformed may reach it
+  if (!PositionManager::is_valid_fen(fen)) {
+    resetToStartingPosition();
+    return false;
+  }
+  PositionManager::set(fen, position);
+  // the side that just moved cannot have left its king in check
+  if (isInCheck(~position.turn())) {
+    resetToStartingPosition();
+    return false;
+  }
+  moveStack.clear();
+  repetition_history.clear();
+  repetition_history.push_back(position.get_hash());
+
+  for (const std::string &s : moves) {
+    Move m = parseMoveString(s);
+    if (m == Move())
+      return false;
+    makeMove(m);
+  }
+  return true;
+}
+
 PieceType ChessEngine::getPieceAt(Square sq, Color &color) {
   Piece piece = position.at(sq);
   if (piece == NO_PIECE) {
@@ -85,6 +128,19 @@ std::vector<Move> ChessEngine::generateLegalMoves() {
 }
 
 bool ChessEngine::makeMove(const Move &move) {
+  // the history has room for HISTORY_PLIES, so a long game sheds its oldest
+  // plies near the top, mid-search or not. Repetitions are found in
+  // repetition_history, which keeps every ply. The accumulators are indexed
+  // by ply and are rebuilt.
+  if (position.ply() >= HISTORY_PLIES - 2) {
+    position.drop_history(MAX_PLY);
+    invalidateAccumulators();
+  }
+
+  // the child's bucket loads while the move is played and the search
+  // does its repetition and draw checks
+  tt->prefetch(position.key_after(move));
+
   moveStack.push_back(move);
   if (position.turn() == WHITE) {
     position.play<WHITE>(move);
@@ -101,6 +157,10 @@ void ChessEngine::unmakeMove() {
     std::cout << "Move stack is empty, nothing to undo.\n";
     return;
   }
+  if (position.ply() == 0) {
+    std::cout << "Earlier moves were dropped from the history, cannot undo.\n";
+    return;
+  }
   Move lastMove = moveStack.back();
   moveStack.pop_back();
   if (!repetition_history.empty())
@@ -119,6 +179,9 @@ void ChessEngine::unmakeMove() {
 Color ChessEngine::getSideToMove() const { return position.turn(); }
 
 bool ChessEngine::isInCheck(Color side) const {
+  // the side to move's checkers are cached for every ply
+  if (side == position.turn())
+    return position.checkers() != 0;
   return (side == WHITE) ? position.in_check<WHITE>()
                          : position.in_check<BLACK>();
 }
@@ -170,6 +233,59 @@ std::string ChessEngine::moveToString(const Move &move) const {
   return ss.str();
 }
 
+std::string ChessEngine::moveToSAN(const Move &move) {
+  MoveFlags f = move.flags();
+  std::string s;
+  if (f == OO) {
+    s = "O-O";
+  } else if (f == OOO) {
+    s = "O-O-O";
+  } else {
+    Square from = move.from();
+    Square to = move.to();
+    PieceType pt = piece_type(position.at(from));
+    bool capture = f & CAPTURE;
+
+    if (pt == PAWN) {
+      if (capture)
+        s += static_cast<char>('a' + file_of(from));
+    } else {
+      s += "NBRQK"[pt - 1];
+      // name the file, else the rank, else both, of a piece that shares the
+      // destination with another of its kind
+      bool ambiguous = false, same_file = false, same_rank = false;
+      for (const Move &m : generateLegalMoves()) {
+        if (m.to() != to || m.from() == from ||
+            piece_type(position.at(m.from())) != pt)
+          continue;
+        ambiguous = true;
+        same_file |= file_of(m.from()) == file_of(from);
+        same_rank |= rank_of(m.from()) == rank_of(from);
+      }
+      if (ambiguous && (!same_file || same_rank))
+        s += static_cast<char>('a' + file_of(from));
+      if (ambiguous && same_file)
+        s += static_cast<char>('1' + rank_of(from));
+    }
+
+    if (capture)
+      s += 'x';
+    s += SQUARE_STR[to];
+    if (f & PR_KNIGHT) {
+      s += '=';
+      s += "NBRQ"[f & 3];
+    }
+  }
+
+  makeMove(move);
+  if (isCheckmate())
+    s += '#';
+  else if (isInCheck(getSideToMove()))
+    s += '+';
+  unmakeMove();
+  return s;
+}
+
 std::string ChessEngine::moveToUCI(const Move &move) const {
   std::string s;
   s += static_cast<char>('a' + file_of(move.from()));
@@ -190,39 +306,10 @@ std::string ChessEngine::moveToUCI(const Move &move) const {
 }
 
 void ChessEngine::resetSearchStats() {
-  searchStats = {0, 0, 0, 0, 0, 0, 0, 0};
+  searchStats = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
   total_nodes = 0;
 }
 
-std::vector<AnalysisResult>
-ChessEngine::runAnalysis(const std::vector<std::string> &positions,
-                         int time_per_position_ms) {
-  std::vector<AnalysisResult> results;
-  for (const std::string &fen : positions) {
-    PositionManager::set(fen, position);
-    moveStack.clear();
-    repetition_history.clear();
-    repetition_history.push_back(position.get_hash());
-
-    resetSearchStats();
-    auto start_time = std::chrono::high_resolution_clock::now();
-    Move best_move = getBestMoveWithTime(time_per_position_ms);
-    auto end_time = std::chrono::high_resolution_clock::now();
-    double elapsed =
-        std::chrono::duration<double, std::milli>(end_time - start_time)
-            .count();
-
-    AnalysisResult r;
-    r.nodes = searchStats.nodes;
-    r.time_ms = elapsed;
-    r.depth_reached = last_search_depth;
-    r.best_move = moveToUCI(best_move);
-    r.score = last_score;
-    results.push_back(r);
-  }
-  return results;
-}
-
 void ChessEngine::printSearchStats() {
   double branching = 0;
   if (searchStats.moves_searched > 0 && searchStats.nodes > 0)
@@ -230,6 +317,12 @@ void ChessEngine::printSearchStats() {
   double hash_rate = 0;
   if (searchStats.nodes > 0)
     hash_rate = (double)searchStats.hash_hits / searchStats.nodes * 100.0;
+  double eval_cache_rate = 0;
+  int64_t eval_lookups =
+      searchStats.eval_cache_hits + searchStats.eval_cache_misses;
+  if (eval_lookups > 0)
+    eval_cache_rate =
+        (double)searchStats.eval_cache_hits / eval_lookups * 100.0;
   double cutoff_rate = 0;
   if (searchStats.fail_high > 0)
     cutoff_rate =
@@ -246,35 +339,37 @@ void ChessEngine::printSearchStats() {
             << searchStats.fail_high << " (" << cutoff_rate << "%)\n"
             << " - Null prunes: " << searchStats.null_prunes << "\n"
             << " - Hash used: " << searchStats.hash_used << "\n"
+            << " - Eval cache hits: " << searchStats.eval_cache_hits << "/"
+            << eval_lookups << " (" << eval_cache_rate << "%)\n"
             << " - Moves searched: " << searchStats.moves_searched << "\n";
+  if (num_threads > 1)
+    std::cout << " - Threads: " << num_threads << " (" << total_nodes
+              << " nodes across all threads)\n";
 }
 
-uint64_t ChessEngine::perft(int depth) {
-  if (depth == 0)
-    return 1;
-  std::vector<Move> moves = generateLegalMoves();
-  if (depth == 1)
-    return moves.size();
-  uint64_t nodes = 0;
-  for (const Move &move : moves) {
-    makeMove(move);
-    nodes += perft(depth - 1);
-    unmakeMove();
-  }
-  return nodes;
-}
+uint64_t ChessEngine::perft(int depth) { return ::perft(position, depth); }
 
-void ChessEngine::perftDivide(int depth) {
-  std::vector<Move> moves = generateLegalMoves();
-  uint64_t total = 0;
-  for (const Move &move : moves) {
-    makeMove(move);
-    uint64_t count = (depth > 1) ? perft(depth - 1) : 1;
-    unmakeMove();
-    std::cout << moveToUCI(move) << ": " << count << std::endl;
-    total += count;
-  }
+void ChessEngine::perftDivide(int depth, int threads, int hash_mb) {
+  std::unique_ptr<PerftTable> table;
+  if (hash_mb > 0)
+    table = std::make_unique<PerftTable>((size_t)hash_mb);
+
+  std::vector<PerftDivide> divide;
+  auto start = std::chrono::steady_clock::now();
+  uint64_t total =
+      perft_parallel(position, depth, threads, table.get(), &divide);
+  auto end = std::chrono::steady_clock::now();
+  double time_ms =
+      std::chrono::duration<double, std::milli>(end - start).count();
+
+  for (const PerftDivide &d : divide)
+    std::cout << moveToUCI(d.move) << ": " << d.nodes << std::endl;
   std::cout << "\nTotal: " << total << std::endl;
+  std::cout << "Time: " << (uint64_t)time_ms << " ms  NPS: "
+            << (uint64_t)(time_ms > 0 ? total * 1000.0 / time_ms : 0)
+            << "  (" << std::max(1, threads) << " thread(s)"
+            << (table ? ", " + std::to_string(hash_mb) + " MB hash" : "")
+            << ")" << std::endl;
 }
 
 void ChessEngine::testPerft() {
@@ -438,49 +533,96 @@ void ChessEngine::uciLoop() {
     } else if (token == "uci") {
       std::cout << "id name ChessGS\n"
                 << "id author James Kaddissi\n"
-                << "option name Hash type spin default 64 min 1 max 1024\n"
-                << "option name Threads type spin default 1 min 1 max 8\n"
+                << "option name Hash type spin default " << DEFAULT_HASH_MB
+                << " min 1 max " << MAX_HASH_MB << "\n"
+                << "option name HashFile type string default <empty>\n"
+                << "option name Threads type spin default 1 min 1 max "
+                << MAX_THREADS << "\n"
+                << "option name EvalFile type string default <empty>\n"
+                << "option name UseNNUE type check default false\n"
                 << "uciok\n";
     } else if (token == "isready") {
       std::cout << "readyok" << std::endl;
+    } else if (token == "setoption") {
+      std::string name, value;
+      iss >> token;
+      while (iss >> token && token != "value")
+        name += (name.empty() ? "" : " ") + token;
+      std::getline(iss >> std::ws, value);
+      if (name == "Threads")
+        setThreads(std::atoi(value.c_str()));
+      else if (name == "Hash")
+        setHashSize(std::atoi(value.c_str()));
+      else if (name == "HashFile")
+        hash_file = (value == "<empty>") ? "" : value;
+      else if (name == "EvalFile" && value != "<empty>") {
+        bool ok = loadNetwork(value);
+        std::cout << "info string "
+                  << (ok ? "loaded network " : "failed to load network ")
+                  << value << std::endl;
+      } else if (name == "UseNNUE") {
+        setUseNNUE(value == "true");
+        if (use_nnue && !network)
+          std::cout << "info string UseNNUE needs an EvalFile, using the "
+                       "classical eval"
+                    << std::endl;
+      }
+    } else if (token == "savehash" || token == "loadhash") {
+      std::string path = hash_file;
+      iss >> path;
+      if (path.empty()) {
+        std::cout << "info string no hash file given" << std::endl;
+      } else if (token == "savehash") {
+        bool ok = saveHash(path);
+        std::cout << "info string " << (ok ? "saved " : "failed to save ")
+                  << path << std::endl;
+      } else {
+        bool ok = loadHash(path);
+        std::cout << "info string " << (ok ? "loaded " : "failed to load ")
+                  << path << " (" << getHashSize() << " MB)" << std::endl;
+      }
     } else if (token == "ucinewgame") {
       clearTables();
       resetToStartingPosition();
     } else if (token == "position") {
+      std::string fen = DEFAULT_FEN;
       iss >> token;
-      if (token == "startpos") {
-        resetToStartingPosition();
-        iss >> token;
-      } else if (token == "fen") {
-        std::string fen;
+      if (token == "fen") {
+        fen.clear();
         while (iss >> token && token != "moves") {
           fen += token + " ";
         }
-        PositionManager::set(fen, position);
-        moveStack.clear();
-        repetition_history.clear();
-        repetition_history.push_back(position.get_hash());
+      } else {
+        iss >> token;
       }
 
+      std::vector<std::string> moves;
       if (token == "moves") {
         std::string moveStr;
-        while (iss >> moveStr) {
-          Move m = parseMoveString(moveStr);
-          if (m != Move())
-            makeMove(m);
-        }
+        while (iss >> moveStr)
+          moves.push_back(moveStr);
       }
+      if (!setPosition(fen, moves))
+        std::cout << "info string illegal position or move" << std::endl;
     } else if (token == "go") {
-      int depth = 6;
+      int depth = 0;
       int movetime = 0;
+      uint64_t nodes = 0;
       while (iss >> token) {
         if (token == "depth")
           iss >> depth;
         else if (token == "movetime")
           iss >> movetime;
+        else if (token == "nodes")
+          iss >> nodes;
       }
-      Move best_move =
-          (movetime > 0) ? getBestMoveWithTime(movetime) : getBestMove(depth);
+      // a bare go keeps the old fixed depth
+      if (depth <= 0)
+        depth = (movetime > 0 || nodes > 0) ? MAX_B_DEPTH : 6;
+      setNodeLimit(nodes);
+      Move best_move = (movetime > 0) ? getBestMoveWithTime(movetime, depth)
+                                      : getBestMove(depth);
+      setNodeLimit(0);
       std::cout << "bestmove " << moveToUCI(best_move) << std::endl;
     }
   }
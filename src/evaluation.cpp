@@ -3,29 +3,14 @@
 #include <algorithm>
 #include <cmath>
 
-static constexpr int PAWN_VALUE = 100;
-static constexpr int KNIGHT_VALUE = 300;
-static constexpr int BISHOP_VALUE = 300;
-static constexpr int ROOK_VALUE = 500;
-static constexpr int QUEEN_VALUE = 900;
 static constexpr int MG_TEMPO = 10;
 static constexpr int EG_TEMPO = 5;
 static constexpr int BISHOP_PAIR = 30;
 static constexpr int P_KNIGHT_PAIR = 10;
 static constexpr int P_ROOK_PAIR = 20;
-static constexpr int PHASE_KNIGHT = 1;
-static constexpr int PHASE_BISHOP = 1;
-static constexpr int PHASE_ROOK = 2;
-static constexpr int PHASE_QUEEN = 4;
-static constexpr int PHASE_MAX =
-    PHASE_KNIGHT * 4 + PHASE_BISHOP * 4 + PHASE_ROOK * 4 + PHASE_QUEEN * 2;
 
 static constexpr int KING_SAFETY_CAP = 200;
 
-static inline int pst_index(Color c, Square sq) {
-  return (c == WHITE) ? (sq ^ 56) : sq;
-}
-
 Bitboard ChessEngine::getFriendlyPieces(Color color) const {
   return (color == WHITE) ? position.all_pieces<WHITE>()
                           : position.all_pieces<BLACK>();
@@ -36,8 +21,12 @@ int ChessEngine::eval() {
   if (phase > PHASE_MAX)
     phase = PHASE_MAX;
 
-  Score white = evaluate_color(WHITE);
-  Score black = evaluate_color(BLACK);
+  // material and PSTs are summed incrementally as pieces move
+  Score white(position.psq_mg(), position.psq_eg());
+  Score black;
+
+  white += evaluate_color(WHITE);
+  black += evaluate_color(BLACK);
 
   white += evalEndgameTerms(WHITE);
   black += evalEndgameTerms(BLACK);
@@ -60,16 +49,149 @@ int ChessEngine::eval() {
   return blended * perspective;
 }
 
+int ChessEngine::cachedEval() {
+  uint64_t key = position.get_hash();
+  uint64_t &slot = eval_cache[key & (EVAL_CACHE_SIZE - 1)];
+  if ((slot & ~0xffffULL) == (key & ~0xffffULL) && slot != 0) {
+    searchStats.eval_cache_hits++;
+    return (int16_t)(slot & 0xffff);
+  }
+
+  searchStats.eval_cache_misses++;
+  int raw = usingNNUE() ? nnueEval() : eval();
+  int score = std::max(-32767, std::min(32767, raw));
+  slot = (key & ~0xffffULL) | (uint16_t)(int16_t)score;
+  return score;
+}
+
+bool ChessEngine::loadNetwork(const std::string &path) {
+  auto net = std::make_shared<NnueNetwork>();
+  if (!net->load(path))
+    return false;
+  setNetwork(std::move(net), use_nnue);
+  return true;
+}
+
+void ChessEngine::setUseNNUE(bool on) { setNetwork(network, on); }
+
+void ChessEngine::setNetwork(std::shared_ptr<const NnueNetwork> net,
+                             bool enabled) {
+  if (net != network || enabled != use_nnue) {
+    // cached evals and accumulators came from the previous evaluator
+    std::fill(eval_cache.begin(), eval_cache.end(), 0);
+    invalidateAccumulators();
+  }
+  network = std::move(net);
+  use_nnue = enabled;
+  if (network && nnue_stack.empty())
+    nnue_stack.resize(std::size(position.history));
+}
+
+void ChessEngine::invalidateAccumulators() {
+  for (int p = 0; p <= position.ply(); p++)
+    position.history[p].nnue_computed = 0;
+}
+
+// the features the move into a ply adds and removes for one perspective. The
+// perspective's own king never moves here; that forces a refresh instead.
+static void nnue_move_delta(const UndoInfo &u, Color perspective, Square king,
+                            NnueDelta &d) {
+  const Move m = u.move;
+  if (m == Move())
+    return; // null move: same pieces, same features
+
+  const Piece pc = u.moved;
+  const Color c = piece_color(pc);
+  const Square from = m.from(), to = m.to();
+  const MoveFlags mf = m.flags();
+  auto add = [&](Piece p, Square s) {
+    d.added[d.num_added++] = NnueNetwork::featureIndex(perspective, king, p, s);
+  };
+  auto remove = [&](Piece p, Square s) {
+    d.removed[d.num_removed++] =
+        NnueNetwork::featureIndex(perspective, king, p, s);
+  };
+
+  if (mf == OO || mf == OOO) {
+    // kings are not features, only the rook moves
+    const Piece rook = make_piece(c, ROOK);
+    remove(rook, Square(mf == OO ? from + 3 : from - 4));
+    add(rook, Square(mf == OO ? from + 1 : from - 1));
+    return;
+  }
+
+  if (piece_type(pc) != KING)
+    remove(pc, from);
+  if (mf == EN_PASSANT)
+    remove(make_piece(~c, PAWN), Square(to ^ 8));
+  else if (mf & CAPTURE)
+    remove(u.captured, to);
+
+  if (mf & PR_KNIGHT)
+    add(make_piece(c, PieceType(KNIGHT + (mf & 0b11))), to);
+  else if (piece_type(pc) != KING)
+    add(pc, to);
+}
+
+void ChessEngine::updateAccumulator(Color perspective) {
+  UndoInfo *history = position.history;
+  const uint8_t bit = 1 << perspective;
+  const int ply = position.ply();
+  if (history[ply].nnue_computed & bit)
+    return;
+
+  const Piece ourKing = make_piece(perspective, KING);
+  const Square king = bsf(position.bitboard_of(ourKing));
+
+  // walk back to the last up-to-date accumulator. A move by this side's king
+  // re-indexes every feature, so past one only a refresh will do.
+  int base = ply;
+  while (base > 0 && !(history[base].nnue_computed & bit) &&
+         history[base].moved != ourKing)
+    base--;
+
+  if (!(history[base].nnue_computed & bit)) {
+    int features[32];
+    int n = 0;
+    Bitboard pieces = (position.all_pieces<WHITE>() |
+                       position.all_pieces<BLACK>()) &
+                      ~position.bitboard_of(WHITE, KING) &
+                      ~position.bitboard_of(BLACK, KING);
+    while (pieces) {
+      Square sq = pop_lsb(&pieces);
+      features[n++] =
+          NnueNetwork::featureIndex(perspective, king, position.at(sq), sq);
+    }
+    network->refresh(nnue_stack[ply].values[perspective], features, n);
+    history[ply].nnue_computed |= bit;
+    return;
+  }
+
+  for (int p = base + 1; p <= ply; p++) {
+    NnueDelta d;
+    nnue_move_delta(history[p], perspective, king, d);
+    network->update(nnue_stack[p].values[perspective],
+                    nnue_stack[p - 1].values[perspective], d);
+    history[p].nnue_computed |= bit;
+  }
+}
+
+int ChessEngine::nnueEval() {
+  updateAccumulator(WHITE);
+  updateAccumulator(BLACK);
+  const NnueAccumulator &acc = nnue_stack[position.ply()];
+  const Color us = position.turn();
+  int score = network->evaluate(acc.values[us], acc.values[~us]);
+  return std::clamp(score, -NNUE_MAX_EVAL, NNUE_MAX_EVAL);
+}
+
 Score ChessEngine::evaluate_color(Color color) {
   Score eval;
 
-  eval += count_material(color);
-  eval += evalPawns(color);
   eval += evalKnights(color);
   eval += evalBishops(color);
   eval += evalRooks(color);
   eval += evalQueens(color);
-  eval += evalKing(color);
 
   eval += evalPawnStructure(color);
   eval += evalKingVulnerability(color);
@@ -78,86 +200,90 @@ Score ChessEngine::evaluate_color(Color color) {
 }
 
 Score ChessEngine::evalPawnStructure(Color color) {
-  Score score;
-  Bitboard pawns = position.bitboard_of(color, PAWN);
-
-  // doubled pawns penalty for each extra pawn on the same file
-  for (int i = 0; i < 8; i++) {
-    int count = sparse_pop_count(pawns & MASK_FILE[i]);
-    if (count > 1) {
-      score.mg -= 10 * (count - 1);
-      score.eg -= 20 * (count - 1);
-    }
-  }
+  return probePawnTable().score[color];
+}
 
-  // no friendly pawns on adjacent files
-  Bitboard isolatedPawns = 0;
-  for (int i = 0; i < 8; i++) {
-    Bitboard file_pawns = pawns & MASK_FILE[i];
-    if (file_pawns) {
-      Bitboard adjacent_files = 0;
-      if (i > 0)
-        adjacent_files |= MASK_FILE[i - 1];
-      if (i < 7)
-        adjacent_files |= MASK_FILE[i + 1];
-      if (!(pawns & adjacent_files))
-        isolatedPawns |= file_pawns;
-    }
+const PawnEntry &ChessEngine::probePawnTable() {
+  uint64_t key = position.get_pawn_hash();
+  PawnEntry &entry = pawn_table[key & (PAWN_TABLE_SIZE - 1)];
+  if (entry.key != key) {
+    entry.key = key;
+    computePawnEntry(entry);
   }
-  score.mg -= 20 * sparse_pop_count(isolatedPawns);
-  score.eg -= 10 * sparse_pop_count(isolatedPawns);
-
-  // no enemy pawn on same or adjacent files in front of us
-  Bitboard enemy_pawns = position.bitboard_of(~color, PAWN);
-  Bitboard passed = 0;
-
-  Bitboard work = pawns;
-  while (work) {
-    Square sq = pop_lsb(&work);
-    int file = file_of(sq);
-
-    Bitboard front_span_own_file = 0;
-    if (color == WHITE) {
-      for (int r = rank_of(sq) + 1; r <= RANK8; r++)
-        front_span_own_file |= SQUARE_BB[create_square(File(file), Rank(r))];
-    } else {
-      for (int r = rank_of(sq) - 1; r >= RANK1; r--)
-        front_span_own_file |= SQUARE_BB[create_square(File(file), Rank(r))];
+  return entry;
+}
+
+// squares strictly in front of sq from color's point of view, all files
+static inline Bitboard forward_ranks(Color color, Square sq) {
+  int rank = rank_of(sq);
+  if (color == WHITE)
+    return rank == RANK8 ? 0 : ~0ULL << (8 * (rank + 1));
+  return (1ULL << (8 * rank)) - 1;
+}
+
+void ChessEngine::computePawnEntry(PawnEntry &entry) {
+  for (Color color : {WHITE, BLACK}) {
+    Score score;
+    Bitboard pawns = position.bitboard_of(color, PAWN);
+
+    // doubled pawns penalty for each extra pawn on the same file
+    for (int i = 0; i < 8; i++) {
+      int count = sparse_pop_count(pawns & MASK_FILE[i]);
+      if (count > 1) {
+        score.mg -= 10 * (count - 1);
+        score.eg -= 20 * (count - 1);
+      }
     }
 
-    Bitboard adj_front = 0;
-    if (color == WHITE) {
-      for (int r = rank_of(sq) + 1; r <= RANK8; r++) {
-        if (file > 0)
-          adj_front |= SQUARE_BB[create_square(File(file - 1), Rank(r))];
-        if (file < 7)
-          adj_front |= SQUARE_BB[create_square(File(file + 1), Rank(r))];
+    // no friendly pawns on adjacent files
+    Bitboard isolatedPawns = 0;
+    for (int i = 0; i < 8; i++) {
+      Bitboard file_pawns = pawns & MASK_FILE[i];
+      if (file_pawns) {
+        Bitboard adjacent_files = 0;
+        if (i > 0)
+          adjacent_files |= MASK_FILE[i - 1];
+        if (i < 7)
+          adjacent_files |= MASK_FILE[i + 1];
+        if (!(pawns & adjacent_files))
+          isolatedPawns |= file_pawns;
       }
-    } else {
-      for (int r = rank_of(sq) - 1; r >= RANK1; r--) {
-        if (file > 0)
-          adj_front |= SQUARE_BB[create_square(File(file - 1), Rank(r))];
-        if (file < 7)
-          adj_front |= SQUARE_BB[create_square(File(file + 1), Rank(r))];
+    }
+    score.mg -= 20 * sparse_pop_count(isolatedPawns);
+    score.eg -= 10 * sparse_pop_count(isolatedPawns);
+
+    // no enemy pawn on same or adjacent files in front of us
+    Bitboard enemy_pawns = position.bitboard_of(~color, PAWN);
+    Bitboard passed = 0;
+
+    Bitboard work = pawns;
+    while (work) {
+      Square sq = pop_lsb(&work);
+      int file = file_of(sq);
+
+      Bitboard files = MASK_FILE[file];
+      if (file > 0)
+        files |= MASK_FILE[file - 1];
+      if (file < 7)
+        files |= MASK_FILE[file + 1];
+
+      Bitboard sentinel_zone = forward_ranks(color, sq) & files;
+      if (!(sentinel_zone & enemy_pawns)) {
+        passed |= SQUARE_BB[sq];
       }
     }
 
-    Bitboard sentinel_zone = front_span_own_file | adj_front;
-    if (!(sentinel_zone & enemy_pawns)) {
-      passed |= SQUARE_BB[sq];
-    }
-  }
+    while (passed) {
+      Square sq = pop_lsb(&passed);
+      int rank = rank_of(sq);
+      int color_based_rank = (color == WHITE) ? rank : 7 - rank;
 
-  while (passed) {
-    Square sq = pop_lsb(&passed);
-    int rank = rank_of(sq);
-    int color_based_rank = (color == WHITE) ? rank : 7 - rank;
+      score.mg += 10 * (color_based_rank + 1) * (color_based_rank + 1);
+      score.eg += 20 * (color_based_rank + 1) * (color_based_rank + 1);
+    }
 
-    score.mg += 10 * (color_based_rank + 1) * (color_based_rank + 1);
-    score.eg += 20 * (color_based_rank + 1) * (color_based_rank + 1);
+    entry.score[color] = score;
   }
-
-  return score;
 }
 
 Score ChessEngine::evalKingVulnerability(Color color) {
@@ -211,19 +337,6 @@ Score ChessEngine::evalKingVulnerability(Color color) {
   return score;
 }
 
-int ChessEngine::count_material(Color color) {
-  int material = 0;
-  material += sparse_pop_count(position.bitboard_of(color, PAWN)) * PAWN_VALUE;
-  material +=
-      sparse_pop_count(position.bitboard_of(color, KNIGHT)) * KNIGHT_VALUE;
-  material +=
-      sparse_pop_count(position.bitboard_of(color, BISHOP)) * BISHOP_VALUE;
-  material += sparse_pop_count(position.bitboard_of(color, ROOK)) * ROOK_VALUE;
-  material +=
-      sparse_pop_count(position.bitboard_of(color, QUEEN)) * QUEEN_VALUE;
-  return material;
-}
-
 int ChessEngine::non_pawn_material(Color color) {
   int material = 0;
   material +=
@@ -236,34 +349,7 @@ int ChessEngine::non_pawn_material(Color color) {
   return material;
 }
 
-int ChessEngine::game_phase() {
-  int phase = 0;
-  phase += sparse_pop_count(position.bitboard_of(WHITE, KNIGHT) |
-                            position.bitboard_of(BLACK, KNIGHT)) *
-           PHASE_KNIGHT;
-  phase += sparse_pop_count(position.bitboard_of(WHITE, BISHOP) |
-                            position.bitboard_of(BLACK, BISHOP)) *
-           PHASE_BISHOP;
-  phase += sparse_pop_count(position.bitboard_of(WHITE, ROOK) |
-                            position.bitboard_of(BLACK, ROOK)) *
-           PHASE_ROOK;
-  phase += sparse_pop_count(position.bitboard_of(WHITE, QUEEN) |
-                            position.bitboard_of(BLACK, QUEEN)) *
-           PHASE_QUEEN;
-  return phase;
-}
-
-Score ChessEngine::evalPawns(Color color) {
-  Score score;
-  Bitboard pawns = position.bitboard_of(color, PAWN);
-  while (pawns) {
-    Square sq = pop_lsb(&pawns);
-    int idx = pst_index(color, sq);
-    score.mg += MG_PAWN_PST[idx];
-    score.eg += EG_PAWN_PST[idx];
-  }
-  return score;
-}
+int ChessEngine::game_phase() { return position.phase(); }
 
 Score ChessEngine::evalKnightMobility(Square sq, Color color, Bitboard poss) {
   (void)sq;
@@ -291,9 +377,6 @@ Score ChessEngine::evalKnights(Color color) {
 
   while (knights) {
     Square sq = pop_lsb(&knights);
-    int idx = pst_index(color, sq);
-    score.mg += MG_KNIGHT_PST[idx];
-    score.eg += EG_KNIGHT_PST[idx];
 
     Bitboard kn_attacks = KNIGHT_ATTACKS[sq];
     Bitboard reachable = kn_attacks & ~getFriendlyPieces(color);
@@ -325,9 +408,6 @@ Score ChessEngine::evalBishops(Color color) {
 
   while (bishops) {
     Square sq = pop_lsb(&bishops);
-    int idx = pst_index(color, sq);
-    score.mg += MG_BISHOP_PST[idx];
-    score.eg += EG_BISHOP_PST[idx];
 
     Bitboard b_attacks = get_bishop_attacks(sq, occ);
     Bitboard reachable = b_attacks & ~getFriendlyPieces(color);
@@ -360,9 +440,6 @@ Score ChessEngine::evalRooks(Color color) {
 
   while (rooks) {
     Square sq = pop_lsb(&rooks);
-    int idx = pst_index(color, sq);
-    score.mg += MG_ROOK_PST[idx];
-    score.eg += EG_ROOK_PST[idx];
 
     Bitboard r_attacks = get_rook_attacks(sq, occ);
     Bitboard reachable = r_attacks & ~getFriendlyPieces(color);
@@ -390,9 +467,6 @@ Score ChessEngine::evalQueens(Color color) {
 
   while (queens) {
     Square sq = pop_lsb(&queens);
-    int idx = pst_index(color, sq);
-    score.mg += MG_QUEEN_PST[idx];
-    score.eg += EG_QUEEN_PST[idx];
 
     // early development penalty for queen if minor pieces are still home
     if (color == WHITE && rank_of(sq) > RANK2) {
@@ -431,18 +505,6 @@ Score ChessEngine::evalQueens(Color color) {
   return score;
 }
 
-Score ChessEngine::evalKing(Color color) {
-  Score score;
-  Bitboard king = position.bitboard_of(color, KING);
-  if (!king)
-    return score;
-  Square sq = bsf(king);
-  int idx = pst_index(color, sq);
-  score.mg += MG_KING_PST[idx];
-  score.eg += EG_KING_PST[idx];
-  return score;
-}
-
 Score ChessEngine::evalEndgameTerms(Color color) {
   Score score;
 
@@ -1,9 +1,8 @@
 #include "lookup_tables.h"
 #include "chess_types.h"
 #include <iostream>
-#include <cstring>
 
-const Bitboard KING_ATTACKS[64] = {
+constexpr Bitboard KING_ATTACKS[64] = {
 	0x302, 0x705, 0xe0a, 0x1c14,
 	0x3828, 0x7050, 0xe0a0, 0xc040,
 	0x30203, 0x70507, 0xe0a0e, 0x1c141c,
@@ -22,7 +21,7 @@ const Bitboard KING_ATTACKS[64] = {
 	0x2838000000000000, 0x5070000000000000, 0xa0e0000000000000, 0x40c0000000000000,
 };
 
-const Bitboard KNIGHT_ATTACKS[64] = {
+constexpr Bitboard KNIGHT_ATTACKS[64] = {
 	0x20400, 0x50800, 0xa1100, 0x142200,
 	0x284400, 0x508800, 0xa01000, 0x402000,
 	0x2040004, 0x5080008, 0xa110011, 0x14220022,
@@ -41,7 +40,7 @@ const Bitboard KNIGHT_ATTACKS[64] = {
 	0x44280000000000, 0x0088500000000000, 0x0010a00000000000, 0x20400000000000
 };
 
-const Bitboard WHITE_PAWN_ATTACKS[64] = {
+constexpr Bitboard WHITE_PAWN_ATTACKS[64] = {
 	0x200, 0x500, 0xa00, 0x1400,
 	0x2800, 0x5000, 0xa000, 0x4000,
 	0x20000, 0x50000, 0xa0000, 0x140000,
@@ -60,7 +59,7 @@ const Bitboard WHITE_PAWN_ATTACKS[64] = {
 	0x0, 0x0, 0x0, 0x0,
 };
 
-const Bitboard BLACK_PAWN_ATTACKS[64] = {
+constexpr Bitboard BLACK_PAWN_ATTACKS[64] = {
 	0x0, 0x0, 0x0, 0x0,
 	0x0, 0x0, 0x0, 0x0,
 	0x2, 0x5, 0xa, 0x14,
@@ -92,16 +91,74 @@ Bitboard sliding_attacks(Square square, Bitboard occ, Bitboard mask) {
 		reverse(reverse(mask & occ) - reverse(SQUARE_BB[square]) * 2)) & mask;
 }
 
-Bitboard get_rook_attacks_for_init(Square square, Bitboard occ) {
-	return sliding_attacks(square, occ, MASK_FILE[file_of(square)]) |
-		sliding_attacks(square, occ, MASK_RANK[rank_of(square)]);
+// compile-time generators. These work from rays built square by square
+// instead of the masks in chess_types.cpp, which are not constant
+// expressions here. Each direction is a (file, rank) step; the first two of
+// each set point towards higher squares.
+static constexpr int ROOK_DIRECTIONS[4][2] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
+static constexpr int BISHOP_DIRECTIONS[4][2] = { { 1, 1 }, { -1, 1 }, { 1, -1 }, { -1, -1 } };
+
+static constexpr bool on_board(int file, int rank) {
+	return file >= 0 && file < 8 && rank >= 0 && rank < 8;
+}
+
+struct Rays {
+	Bitboard rook[4][NSQUARES];
+	Bitboard bishop[4][NSQUARES];
+};
+
+static constexpr Rays build_rays() {
+	Rays rays{};
+	for (int sq = 0; sq < 64; sq++)
+		for (int d = 0; d < 4; d++) {
+			const int* steps[2] = { ROOK_DIRECTIONS[d], BISHOP_DIRECTIONS[d] };
+			Bitboard* out[2] = { &rays.rook[d][sq], &rays.bishop[d][sq] };
+			for (int k = 0; k < 2; k++)
+				for (int f = sq % 8 + steps[k][0], r = sq / 8 + steps[k][1]; on_board(f, r);
+					f += steps[k][0], r += steps[k][1])
+					*out[k] |= 1ULL << (r * 8 + f);
+		}
+	return rays;
+}
+
+static constexpr Rays RAYS = build_rays();
+
+// each ray is cut behind its first blocker, which is its lowest set bit for
+// the upward directions and its highest for the downward ones
+static constexpr Bitboard ray_attacks(int sq, Bitboard occ, const Bitboard (&rays)[4][NSQUARES]) {
+	Bitboard attacks = 0;
+	for (int d = 0; d < 4; d++) {
+		Bitboard ray = rays[d][sq];
+		if (Bitboard blockers = ray & occ) {
+			int first = d < 2 ? std::countr_zero(blockers) : 63 - std::countl_zero(blockers);
+			ray ^= rays[d][first];
+		}
+		attacks |= ray;
+	}
+	return attacks;
+}
+
+// the squares whose occupancy matters: each ray without its last square
+static constexpr Bitboard relevant_occupancy(int sq, const Bitboard (&rays)[4][NSQUARES]) {
+	Bitboard mask = 0;
+	for (int d = 0; d < 4; d++) {
+		Bitboard ray = rays[d][sq];
+		if (ray)
+			ray &= ~(1ULL << (d < 2 ? 63 - std::countl_zero(ray) : std::countr_zero(ray)));
+		mask |= ray;
+	}
+	return mask;
 }
 
-Bitboard ROOK_ATTACK_MASKS[64];
-int ROOK_ATTACK_SHIFTS[64];
-Bitboard ROOK_ATTACKS[64][4096];
+// software PEXT, so BMI2 builds can lay out their table at compile time
+static constexpr Bitboard pext(Bitboard x, Bitboard mask) {
+	Bitboard result = 0;
+	for (Bitboard bit = 1; mask; mask &= mask - 1, bit <<= 1)
+		if (x & mask & (~mask + 1)) result |= bit;
+	return result;
+}
 
-const Bitboard ROOK_MAGICS[64] = {
+static constexpr Bitboard ROOK_MAGICS[64] = {
 	0x0080001020400080, 0x0040001000200040, 0x0080081000200080, 0x0080040800100080,
 	0x0080020400080080, 0x0080010200040080, 0x0080008001000200, 0x0080002040800100,
 	0x0000800020400080, 0x0000400020005000, 0x0000801000200080, 0x0000800800100080,
@@ -120,43 +177,7 @@ const Bitboard ROOK_MAGICS[64] = {
 	0x0001000204080011, 0x0001000204000801, 0x0001000082000401, 0x0001FFFAABFAD1A2
 };
 
-void initialise_rook_attacks() {
-	Bitboard edges, subset, index;
-
-	for (Square sq = A1; sq <= H8; ++sq) {
-		edges = ((MASK_RANK[AFILE] | MASK_RANK[HFILE]) & ~MASK_RANK[rank_of(sq)]) |
-			((MASK_FILE[AFILE] | MASK_FILE[HFILE]) & ~MASK_FILE[file_of(sq)]);
-		ROOK_ATTACK_MASKS[sq] = (MASK_RANK[rank_of(sq)]
-			^ MASK_FILE[file_of(sq)]) & ~edges;
-		ROOK_ATTACK_SHIFTS[sq] = 64 - pop_count(ROOK_ATTACK_MASKS[sq]);
-
-		subset = 0;
-		do {
-			index = subset;
-			index = index * ROOK_MAGICS[sq];
-			index = index >> ROOK_ATTACK_SHIFTS[sq];
-			ROOK_ATTACKS[sq][index] = get_rook_attacks_for_init(sq, subset);
-			subset = (subset - ROOK_ATTACK_MASKS[sq]) & ROOK_ATTACK_MASKS[sq];
-		} while (subset);
-	}
-}
-
-Bitboard get_xray_rook_attacks(Square square, Bitboard occ, Bitboard blockers) {
-	Bitboard attacks = get_rook_attacks(square, occ);
-	blockers &= attacks;
-	return attacks ^ get_rook_attacks(square, occ ^ blockers);
-}
-
-Bitboard get_bishop_attacks_for_init(Square square, Bitboard occ) {
-	return sliding_attacks(square, occ, MASK_DIAGONAL[diagonal_of(square)]) |
-		sliding_attacks(square, occ, MASK_ANTI_DIAGONAL[anti_diagonal_of(square)]);
-}
-
-Bitboard BISHOP_ATTACK_MASKS[64];
-int BISHOP_ATTACK_SHIFTS[64];
-Bitboard BISHOP_ATTACKS[64][512];
-
-const Bitboard BISHOP_MAGICS[64] = {
+static constexpr Bitboard BISHOP_MAGICS[64] = {
 	0x0002020202020200, 0x0002020202020000, 0x0004010202000000, 0x0004040080000000,
 	0x0001104000000000, 0x0000821040000000, 0x0000410410400000, 0x0000104104104000,
 	0x0000040404040400, 0x0000020202020200, 0x0000040102020000, 0x0000040400800000,
@@ -175,82 +196,130 @@ const Bitboard BISHOP_MAGICS[64] = {
 	0x0000000010020200, 0x0000000404080200, 0x0000040404040400, 0x0002020202020200
 };
 
-void initialise_bishop_attacks() {
-	Bitboard edges, subset, index;
+static constexpr std::array<SliderSquare, NSQUARES> build_sliders(
+	const Bitboard (&magics)[NSQUARES], const Bitboard (&rays)[4][NSQUARES], unsigned offset) {
+	std::array<SliderSquare, NSQUARES> t{};
+	for (int sq = 0; sq < 64; sq++) {
+		Bitboard mask = relevant_occupancy(sq, rays);
+		int bits = std::popcount(mask);
+		t[sq] = { mask, magics[sq], unsigned(64 - bits), offset };
+		offset += 1u << bits;
+	}
+	return t;
+}
+
+constexpr std::array<SliderSquare, NSQUARES> ROOK_SLIDERS =
+	build_sliders(ROOK_MAGICS, RAYS.rook, 0);
+constexpr std::array<SliderSquare, NSQUARES> BISHOP_SLIDERS =
+	build_sliders(BISHOP_MAGICS, RAYS.bishop, ROOK_TABLE_SIZE);
 
-	for (Square sq = A1; sq <= H8; ++sq) {
-		edges = ((MASK_RANK[AFILE] | MASK_RANK[HFILE]) & ~MASK_RANK[rank_of(sq)]) |
-			((MASK_FILE[AFILE] | MASK_FILE[HFILE]) & ~MASK_FILE[file_of(sq)]);
-		BISHOP_ATTACK_MASKS[sq] = (MASK_DIAGONAL[diagonal_of(sq)]
-			^ MASK_ANTI_DIAGONAL[anti_diagonal_of(sq)]) & ~edges;
-		BISHOP_ATTACK_SHIFTS[sq] = 64 - pop_count(BISHOP_ATTACK_MASKS[sq]);
+static_assert(ROOK_SLIDERS[63].offset + (1u << (64 - ROOK_SLIDERS[63].shift)) == ROOK_TABLE_SIZE);
+static_assert(BISHOP_SLIDERS[63].offset + (1u << (64 - BISHOP_SLIDERS[63].shift))
+	== ROOK_TABLE_SIZE + BISHOP_TABLE_SIZE);
 
-		subset = 0;
+template<size_t N>
+static constexpr void fill_slider_attacks(std::array<Bitboard, N>& table,
+	const std::array<SliderSquare, NSQUARES>& sliders, const Bitboard (&rays)[4][NSQUARES]) {
+	for (int sq = 0; sq < 64; sq++) {
+		const SliderSquare& s = sliders[sq];
+		Bitboard subset = 0;
 		do {
-			index = subset;
-			index = index * BISHOP_MAGICS[sq];
-			index = index >> BISHOP_ATTACK_SHIFTS[sq];
-			BISHOP_ATTACKS[sq][index] = get_bishop_attacks_for_init(sq, subset);
-			subset = (subset - BISHOP_ATTACK_MASKS[sq]) & BISHOP_ATTACK_MASKS[sq];
+#ifdef USE_PEXT
+			Bitboard index = pext(subset, s.mask);
+#else
+			Bitboard index = (subset * s.magic) >> s.shift;
+#endif
+			table[s.offset + index] = ray_attacks(sq, subset, rays);
+			subset = (subset - s.mask) & s.mask;
 		} while (subset);
 	}
 }
 
+static constexpr std::array<Bitboard, ROOK_TABLE_SIZE + BISHOP_TABLE_SIZE> build_slider_attacks() {
+	std::array<Bitboard, ROOK_TABLE_SIZE + BISHOP_TABLE_SIZE> t{};
+	fill_slider_attacks(t, ROOK_SLIDERS, RAYS.rook);
+	fill_slider_attacks(t, BISHOP_SLIDERS, RAYS.bishop);
+	return t;
+}
+
+constexpr std::array<Bitboard, ROOK_TABLE_SIZE + BISHOP_TABLE_SIZE> SLIDER_ATTACKS =
+	build_slider_attacks();
+
+Bitboard get_xray_rook_attacks(Square square, Bitboard occ, Bitboard blockers) {
+	Bitboard attacks = get_rook_attacks(square, occ);
+	blockers &= attacks;
+	return attacks ^ get_rook_attacks(square, occ ^ blockers);
+}
+
 Bitboard get_xray_bishop_attacks(Square square, Bitboard occ, Bitboard blockers) {
 	Bitboard attacks = get_bishop_attacks(square, occ);
 	blockers &= attacks;
 	return attacks ^ get_bishop_attacks(square, occ ^ blockers);
 }
 
-Bitboard SQUARES_BETWEEN_BB[64][64];
-
-void initialise_squares_between() {
-	Bitboard sqs;
-	for (Square sq1 = A1; sq1 <= H8; ++sq1)
-		for (Square sq2 = A1; sq2 <= H8; ++sq2) {
-			sqs = SQUARE_BB[sq1] | SQUARE_BB[sq2];
-			if (file_of(sq1) == file_of(sq2) || rank_of(sq1) == rank_of(sq2))
-				SQUARES_BETWEEN_BB[sq1][sq2] =
-				get_rook_attacks_for_init(sq1, sqs) & get_rook_attacks_for_init(sq2, sqs);
-			else if (diagonal_of(sq1) == diagonal_of(sq2) || anti_diagonal_of(sq1) == anti_diagonal_of(sq2))
-				SQUARES_BETWEEN_BB[sq1][sq2] =
-				get_bishop_attacks_for_init(sq1, sqs) & get_bishop_attacks_for_init(sq2, sqs);
+static constexpr bool same_orthogonal(int a, int b) {
+	return a % 8 == b % 8 || a / 8 == b / 8;
+}
+
+static constexpr bool same_diagonal(int a, int b) {
+	return a / 8 - a % 8 == b / 8 - b % 8 || a / 8 + a % 8 == b / 8 + b % 8;
+}
+
+static constexpr BitboardTable<NSQUARES> build_squares_between() {
+	BitboardTable<NSQUARES> t{};
+	for (int sq1 = 0; sq1 < 64; sq1++)
+		for (int sq2 = 0; sq2 < 64; sq2++) {
+			Bitboard sqs = (1ULL << sq1) | (1ULL << sq2);
+			if (same_orthogonal(sq1, sq2))
+				t[sq1][sq2] = ray_attacks(sq1, sqs, RAYS.rook) &
+					ray_attacks(sq2, sqs, RAYS.rook);
+			else if (same_diagonal(sq1, sq2))
+				t[sq1][sq2] = ray_attacks(sq1, sqs, RAYS.bishop) &
+					ray_attacks(sq2, sqs, RAYS.bishop);
 		}
+	return t;
 }
 
-Bitboard LINE[64][64];
-
-void initialise_line() {
-	for (Square sq1 = A1; sq1 <= H8; ++sq1)
-		for (Square sq2 = A1; sq2 <= H8; ++sq2) {
-			if (file_of(sq1) == file_of(sq2) || rank_of(sq1) == rank_of(sq2))
-				LINE[sq1][sq2] =
-				get_rook_attacks_for_init(sq1, 0) & get_rook_attacks_for_init(sq2, 0)
-				| SQUARE_BB[sq1] | SQUARE_BB[sq2];
-			else if (diagonal_of(sq1) == diagonal_of(sq2) || anti_diagonal_of(sq1) == anti_diagonal_of(sq2))
-				LINE[sq1][sq2] =
-				get_bishop_attacks_for_init(sq1, 0) & get_bishop_attacks_for_init(sq2, 0)
-				| SQUARE_BB[sq1] | SQUARE_BB[sq2];
+constexpr BitboardTable<NSQUARES> SQUARES_BETWEEN_BB = build_squares_between();
+
+static constexpr BitboardTable<NSQUARES> build_line() {
+	BitboardTable<NSQUARES> t{};
+	for (int sq1 = 0; sq1 < 64; sq1++)
+		for (int sq2 = 0; sq2 < 64; sq2++) {
+			Bitboard ends = (1ULL << sq1) | (1ULL << sq2);
+			if (same_orthogonal(sq1, sq2))
+				t[sq1][sq2] = (ray_attacks(sq1, 0, RAYS.rook) &
+					ray_attacks(sq2, 0, RAYS.rook)) | ends;
+			else if (same_diagonal(sq1, sq2))
+				t[sq1][sq2] = (ray_attacks(sq1, 0, RAYS.bishop) &
+					ray_attacks(sq2, 0, RAYS.bishop)) | ends;
 		}
+	return t;
 }
-Bitboard PAWN_ATTACKS[NCOLORS][NSQUARES];
-Bitboard PSEUDO_LEGAL_ATTACKS[NPIECE_TYPES][NSQUARES];
-void initialise_pseudo_legal() {
-	memcpy(PAWN_ATTACKS[WHITE], WHITE_PAWN_ATTACKS, sizeof(WHITE_PAWN_ATTACKS));
-	memcpy(PAWN_ATTACKS[BLACK], BLACK_PAWN_ATTACKS, sizeof(BLACK_PAWN_ATTACKS));
-	memcpy(PSEUDO_LEGAL_ATTACKS[KNIGHT], KNIGHT_ATTACKS, sizeof(KNIGHT_ATTACKS));
-	memcpy(PSEUDO_LEGAL_ATTACKS[KING], KING_ATTACKS, sizeof(KING_ATTACKS));
-	for (Square s = A1; s <= H8; ++s) {
-		PSEUDO_LEGAL_ATTACKS[ROOK][s] = get_rook_attacks_for_init(s, 0);
-		PSEUDO_LEGAL_ATTACKS[BISHOP][s] = get_bishop_attacks_for_init(s, 0);
-		PSEUDO_LEGAL_ATTACKS[QUEEN][s] = PSEUDO_LEGAL_ATTACKS[ROOK][s] |
-			PSEUDO_LEGAL_ATTACKS[BISHOP][s];
+
+constexpr BitboardTable<NSQUARES> LINE = build_line();
+
+static constexpr BitboardTable<NCOLORS> build_pawn_attacks() {
+	BitboardTable<NCOLORS> t{};
+	for (int sq = 0; sq < 64; sq++) {
+		t[WHITE][sq] = WHITE_PAWN_ATTACKS[sq];
+		t[BLACK][sq] = BLACK_PAWN_ATTACKS[sq];
+	}
+	return t;
+}
+
+constexpr BitboardTable<NCOLORS> PAWN_ATTACKS = build_pawn_attacks();
+
+static constexpr BitboardTable<NPIECE_TYPES> build_pseudo_legal() {
+	BitboardTable<NPIECE_TYPES> t{};
+	for (int sq = 0; sq < 64; sq++) {
+		t[KNIGHT][sq] = KNIGHT_ATTACKS[sq];
+		t[KING][sq] = KING_ATTACKS[sq];
+		t[ROOK][sq] = ray_attacks(sq, 0, RAYS.rook);
+		t[BISHOP][sq] = ray_attacks(sq, 0, RAYS.bishop);
+		t[QUEEN][sq] = t[ROOK][sq] | t[BISHOP][sq];
 	}
+	return t;
 }
-void initialise_all_databases() {
-	initialise_rook_attacks();
-	initialise_bishop_attacks();
-	initialise_squares_between();
-	initialise_line();
-	initialise_pseudo_legal();
-}
\ No newline at end of file
+
+constexpr BitboardTable<NPIECE_TYPES> PSEUDO_LEGAL_ATTACKS = build_pseudo_legal();
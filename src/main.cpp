@@ -1,25 +1,37 @@
 #include <iostream>
 #include <chrono>
+#include <fstream>
 #include <string>
+#include <thread>
 #include "lookup_tables.h"
 #include "bitboard.h"
 #include "chess_types.h"
-#include "window.h"
 #include "engine.h"
+#include "match.h"
+#ifdef CHESSGS_GUI
+#include "window.h"
+#endif
 
 void printUsage() {
     std::cout << "ChessGS - Chess Game and Engine" << std::endl;
     std::cout << "Usage:" << std::endl;
+#ifdef CHESSGS_GUI
     std::cout << "  gui                   - Start the GUI" << std::endl;
-    std::cout << "  uci                   - Start UCI mode" << std::endl;
-    std::cout << "  perft [depth]         - Run Perft test to specified depth" << std::endl;
+#endif
+    std::cout << "  uci [hashfile]        - Start UCI mode, warm-starting from and saving to hashfile" << std::endl;
+    std::cout << "  perft [depth] [threads] [hashMB] - Run Perft test to specified depth" << std::endl;
+    std::cout << "  perftsuite <file.epd> [threads] [maxDepth] - Check perft counts from an EPD file" << std::endl;
     std::cout << "  testsuite [filename]  - Run test suite from file" << std::endl;
+    std::cout << "  annotate <in.epd> <out> [threads] [depth] [movetimeMs] [hashMB] - Annotate every position with a search" << std::endl;
     std::cout << "  selfplay [n] [depth]  - Run n self-play games at specified depth" << std::endl;
-    std::cout << "  benchmark            - Run benchmark" << std::endl;
+    std::cout << "  match [games] [concurrency] [openings|-] [depth] [msPerMove] [netA|-] [netB|-] [pgn] - Play engine A against B" << std::endl;
+    std::cout << "  benchmark [threads] [hashMB] - Run benchmark" << std::endl;
 }
 
-void runBenchmark() {
+void runBenchmark(int threads, int hashMB) {
     ChessEngine engine;
+    engine.setThreads(threads);
+    engine.setHashSize(hashMB);
     
     std::vector<std::string> positions = {
         "r1bqkbnr/pppppppp/2n5/8/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 1",
@@ -28,7 +40,11 @@ void runBenchmark() {
         "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10"
     };
     
-    std::cout << "Running benchmark..." << std::endl;
+    // the positions run side by side, see ChessEngine::runAnalysis
+    std::cout << "Running benchmark with " << engine.getThreads() << " thread(s), "
+              << engine.getHashSize() << " MB hash..." << std::endl;
+    std::cout << "Slider attacks: " << SLIDER_LOOKUP << ", "
+              << sizeof(SLIDER_ATTACKS) / 1024 << " KB" << std::endl;
     engine.resetSearchStats();
     
     auto start = std::chrono::high_resolution_clock::now();
@@ -44,7 +60,9 @@ void runBenchmark() {
                   << " (depth " << results[i].depth_reached 
                   << ", score " << results[i].score 
                   << ", " << results[i].nodes << " nodes, " 
-                  << results[i].time_ms << " ms)" << std::endl;
+                  << results[i].time_ms << " ms, "
+                  << (int)(results[i].nodes * 1000.0 / std::max(1.0, results[i].time_ms))
+                  << " nps)" << std::endl;
         total_nodes += results[i].nodes;
     }
     
@@ -55,40 +73,82 @@ void runBenchmark() {
     engine.printSearchStats();
 }
 
+int runGui() {
+#ifdef CHESSGS_GUI
+    Window window("ChessGS", 1024, 768);
+    if (!window.Initialize()) {
+        std::cerr << "Failed to initialize window" << std::endl;
+        return 1;
+    }
+    window.RenderLoop();
+    return 0;
+#else
+    std::cerr << "Error: This build has no GUI" << std::endl;
+    return 1;
+#endif
+}
+
 int main(int argc, char* argv[]) {
-	initialise_all_databases();
-	zobrist::initialise_zobrist_keys();
-	
     if (argc < 2) {
-        Window window("ChessGS", 1024, 768);
-        if (!window.Initialize()) {
-            std::cerr << "Failed to initialize window" << std::endl;
-            return 1;
-        }
-        window.RenderLoop();
+#ifdef CHESSGS_GUI
+        return runGui();
+#else
+        printUsage();
+#endif
     } else {
         std::string command = argv[1];
         
         if (command == "gui") {
-            Window window("ChessGS", 1024, 768);
-            if (!window.Initialize()) {
-                std::cerr << "Failed to initialize window" << std::endl;
-                return 1;
-            }
-            window.RenderLoop();
+            return runGui();
         } 
         else if (command == "uci") {
             ChessEngine engine;
+            std::string hashFile = argc > 2 ? argv[2] : "";
+            if (!hashFile.empty() && std::ifstream(hashFile).good())
+                engine.loadHash(hashFile);
             engine.uciLoop();
+            if (!hashFile.empty())
+                engine.saveHash(hashFile);
         } 
         else if (command == "perft") {
             int depth = 5;
-            if (argc > 2) {
-                depth = std::stoi(argv[2]);
-            }
+            int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+            int hashMB = 0;
+            if (argc > 2) depth = std::stoi(argv[2]);
+            if (argc > 3) threads = std::stoi(argv[3]);
+            if (argc > 4) hashMB = std::stoi(argv[4]);
             ChessEngine engine;
-            engine.perftDivide(depth);
+            engine.perftDivide(depth, threads, hashMB);
         } 
+        else if (command == "perftsuite") {
+            if (argc < 3) {
+                std::cerr << "Error: No perft suite file specified" << std::endl;
+                return 1;
+            }
+            int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+            int maxDepth = 0;
+            if (argc > 3) threads = std::stoi(argv[3]);
+            if (argc > 4) maxDepth = std::stoi(argv[4]);
+            return run_perft_suite(argv[2], threads, maxDepth) ? 0 : 1;
+        }
+        else if (command == "annotate") {
+            if (argc < 4) {
+                std::cerr << "Error: annotate needs an input and an output file" << std::endl;
+                return 1;
+            }
+            int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+            SearchLimits limits;
+            limits.depth = 10;
+            int hashMB = DEFAULT_HASH_MB;
+            if (argc > 4) threads = std::stoi(argv[4]);
+            if (argc > 5) limits.depth = std::stoi(argv[5]);
+            if (argc > 6) limits.time_ms = std::stoi(argv[6]);
+            if (argc > 7) hashMB = std::stoi(argv[7]);
+            ChessEngine engine;
+            engine.setThreads(threads);
+            engine.setHashSize(hashMB);
+            return engine.annotateFile(argv[2], argv[3], limits) ? 0 : 1;
+        }
         else if (command == "testsuite") {
             if (argc < 3) {
                 std::cerr << "Error: No test suite file specified" << std::endl;
@@ -120,8 +180,29 @@ int main(int argc, char* argv[]) {
             MatchResult result = engine.selfPlayGames(games, depth, useTimeControl, msPerMove, useOpeningBook);
             result.print();
         } 
+        else if (command == "match") {
+            MatchConfig config;
+            config.concurrency = (int)std::max(1u, std::thread::hardware_concurrency());
+            config.limits.depth = 6;
+            config.pgn_path = "match.pgn";
+            // "-" leaves an optional file argument unset
+            auto file = [](const char *arg) { return std::string(arg) == "-" ? std::string() : std::string(arg); };
+            if (argc > 2) config.games = std::stoi(argv[2]);
+            if (argc > 3) config.concurrency = std::stoi(argv[3]);
+            if (argc > 4) config.openings = file(argv[4]);
+            if (argc > 5) config.limits.depth = std::stoi(argv[5]);
+            if (argc > 6) config.limits.time_ms = std::stoi(argv[6]);
+            if (argc > 7) config.network_a = file(argv[7]);
+            if (argc > 8) config.network_b = file(argv[8]);
+            if (argc > 9) config.pgn_path = file(argv[9]);
+            return run_match(config) ? 0 : 1;
+        }
         else if (command == "benchmark") {
-            runBenchmark();
+            int threads = 1;
+            int hashMB = DEFAULT_HASH_MB;
+            if (argc > 2) threads = std::stoi(argv[2]);
+            if (argc > 3) hashMB = std::stoi(argv[3]);
+            runBenchmark(threads, hashMB);
         } 
         else {
             printUsage();
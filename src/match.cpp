@@ -0,0 +1,319 @@
+#include "match.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+static double elo_from_score(double s) {
+  s = std::clamp(s, 1e-6, 1.0 - 1e-6);
+  return 400.0 * std::log10(s / (1.0 - s));
+}
+
+double MatchScore::score() const {
+  int n = games();
+  return n ? (wins + 0.5 * draws) / n : 0.5;
+}
+
+double MatchScore::elo() const { return elo_from_score(score()); }
+
+double MatchScore::eloError() const {
+  int n = games();
+  if (n == 0)
+    return 0;
+  double mu = score();
+  double var = (wins * (1 - mu) * (1 - mu) + draws * (0.5 - mu) * (0.5 - mu) +
+                losses * mu * mu) /
+               n;
+  double dev = 1.96 * std::sqrt(var / n);
+  return (elo_from_score(mu + dev) - elo_from_score(mu - dev)) / 2;
+}
+
+double MatchScore::los() const {
+  if (wins + losses == 0)
+    return 0.5;
+  return 0.5 * (1 + std::erf((wins - losses) / std::sqrt(2.0 * (wins + losses))));
+}
+
+struct MatchOpening {
+  std::string fen;
+  std::vector<std::string> moves; // book moves, played before the engines
+};
+
+static bool load_openings(const MatchConfig &config, int pairs,
+                          std::vector<MatchOpening> &openings) {
+  if (config.openings.empty()) {
+    openings.push_back({DEFAULT_FEN + " 0 1", {}});
+    return true;
+  }
+
+  ChessEngine book(std::make_shared<TranspositionTable>());
+  book.setHashSize(1);
+  if (book.isPolyglotFormat(config.openings)) {
+    book.loadOpeningBook(config.openings);
+    // a random walk per pair, as far as the book goes
+    for (int i = 0; i < pairs; i++) {
+      book.resetToStartingPosition();
+      MatchOpening o{DEFAULT_FEN + " 0 1", {}};
+      for (int ply = 0; ply < MATCH_BOOK_PLIES; ply++) {
+        Move m = book.getOpeningBookMove();
+        if (m == Move())
+          break;
+        o.moves.push_back(book.moveToUCI(m));
+        book.makeMove(m);
+      }
+      openings.push_back(std::move(o));
+    }
+    return true;
+  }
+
+  std::ifstream file(config.openings);
+  if (!file.is_open()) {
+    std::cerr << "Could not open openings: " << config.openings << std::endl;
+    return false;
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    size_t first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos || line[first] == '#')
+      continue;
+    std::string fen = fen_from_epd(line);
+    if (book.setPosition(fen))
+      openings.push_back({fen, {}});
+    else
+      std::cerr << "Skipping unreadable opening: " << line << std::endl;
+  }
+  if (openings.empty()) {
+    std::cerr << "No openings in " << config.openings << std::endl;
+    return false;
+  }
+  return true;
+}
+
+struct MatchGame {
+  int round;
+  bool a_white;
+  std::string fen;
+  std::vector<std::string> sans;     // with their move comments
+  std::string result = "1/2-1/2";
+  std::string reason;
+  int plies = 0;
+};
+
+// plays one game between two engines set to the same opening; white moves
+// first in the opening's position
+static void play_game(ChessEngine &white, ChessEngine &black,
+                      const MatchOpening &opening, const SearchLimits &limits,
+                      MatchGame &game) {
+  for (ChessEngine *e : {&white, &black}) {
+    e->clearTables();
+    e->setPosition(opening.fen);
+  }
+  game.fen = opening.fen;
+
+  size_t book_moves = 0;
+  while (true) {
+    ChessEngine::GameResult state = white.getGameResult();
+    if (state != ChessEngine::GameResult::Ongoing) {
+      game.reason = ChessEngine::gameResultToString(state);
+      if (state == ChessEngine::GameResult::WhiteWinsCheckmate)
+        game.result = "1-0";
+      else if (state == ChessEngine::GameResult::BlackWinsCheckmate)
+        game.result = "0-1";
+      break;
+    }
+
+    ChessEngine &mover = white.getSideToMove() == WHITE ? white : black;
+    Move m;
+    std::string comment;
+    if (book_moves < opening.moves.size()) {
+      m = mover.parseMoveString(opening.moves[book_moves++]);
+      comment = "book";
+    } else {
+      SearchResult r = mover.searchWithLimits(limits);
+      m = mover.parseMoveString(r.best_move);
+      std::ostringstream c;
+      c << std::showpos << std::fixed << std::setprecision(2)
+        << r.score / 100.0 << std::noshowpos << "/" << r.depth << " "
+        << std::setprecision(3) << r.time_ms / 1000.0 << "s";
+      comment = c.str();
+    }
+    if (m == Move()) {
+      // only a broken book line or a search bug gets here
+      bool white_moved = &mover == &white;
+      game.result = white_moved ? "0-1" : "1-0";
+      game.reason = std::string(white_moved ? "White" : "Black") +
+                    " made no legal move";
+      break;
+    }
+
+    game.sans.push_back(white.moveToSAN(m) + " {" + comment + "}");
+    white.makeMove(m);
+    black.makeMove(m);
+    game.plies++;
+  }
+}
+
+static std::string pgn_date() {
+  std::time_t t = std::time(nullptr);
+  std::tm tm{};
+#ifdef _WIN32
+  localtime_s(&tm, &t);
+#else
+  localtime_r(&t, &tm);
+#endif
+  std::ostringstream ss;
+  ss << std::put_time(&tm, "%Y.%m.%d");
+  return ss.str();
+}
+
+static std::string to_pgn(const MatchGame &g, const std::string &date) {
+  std::ostringstream pgn;
+  pgn << "[Event \"ChessGS match\"]\n"
+      << "[Site \"?\"]\n"
+      << "[Date \"" << date << "\"]\n"
+      << "[Round \"" << g.round << "\"]\n"
+      << "[White \"" << (g.a_white ? "A" : "B") << "\"]\n"
+      << "[Black \"" << (g.a_white ? "B" : "A") << "\"]\n"
+      << "[Result \"" << g.result << "\"]\n";
+
+  std::istringstream fen(g.fen);
+  std::string board, side, castling, ep;
+  int halfmove = 0, fullmove = 1;
+  fen >> board >> side >> castling >> ep >> halfmove >> fullmove;
+  if (g.fen.rfind(DEFAULT_FEN, 0) != 0)
+    pgn << "[FEN \"" << g.fen << "\"]\n[SetUp \"1\"]\n";
+  pgn << "[PlyCount \"" << g.plies << "\"]\n\n";
+
+  // movetext wrapped at 80 columns
+  std::string line;
+  auto emit = [&](const std::string &token) {
+    if (!line.empty() && line.size() + 1 + token.size() > 80) {
+      pgn << line << "\n";
+      line.clear();
+    }
+    line += (line.empty() ? "" : " ") + token;
+  };
+  bool black_to_move = side == "b";
+  int number = std::max(1, fullmove);
+  for (size_t i = 0; i < g.sans.size(); i++) {
+    if (!black_to_move)
+      emit(std::to_string(number) + ".");
+    else if (i == 0)
+      emit(std::to_string(number) + "...");
+    emit(g.sans[i]);
+    if (black_to_move)
+      number++;
+    black_to_move = !black_to_move;
+  }
+  emit("{" + g.reason + "}");
+  emit(g.result);
+  pgn << line << "\n\n";
+  return pgn.str();
+}
+
+bool run_match(const MatchConfig &config) {
+  const int pairs = std::max(1, (config.games + 1) / 2);
+  const int games = 2 * pairs;
+
+  std::vector<MatchOpening> openings;
+  if (!load_openings(config, pairs, openings))
+    return false;
+
+  // one copy of each network serves every engine that plays with it
+  std::shared_ptr<const NnueNetwork> nets[2];
+  const std::string *paths[2] = {&config.network_a, &config.network_b};
+  for (int i = 0; i < 2; i++) {
+    if (paths[i]->empty())
+      continue;
+    auto net = std::make_shared<NnueNetwork>();
+    if (!net->load(*paths[i]))
+      return false;
+    nets[i] = std::move(net);
+  }
+
+  std::ofstream pgn;
+  if (!config.pgn_path.empty()) {
+    pgn.open(config.pgn_path, std::ios::app);
+    if (!pgn.is_open()) {
+      std::cerr << "Could not open PGN file: " << config.pgn_path << std::endl;
+      return false;
+    }
+  }
+
+  std::cout << "Match: " << games << " games, " << openings.size()
+            << " opening(s), " << config.concurrency << " concurrent"
+            << std::endl;
+
+  const std::string date = pgn_date();
+  std::atomic<int> next{0};
+  std::mutex report_mutex;
+  MatchScore score;
+  int finished = 0;
+
+  auto worker = [&] {
+    std::unique_ptr<ChessEngine> engines[2];
+    for (int i = 0; i < 2; i++) {
+      engines[i].reset(new ChessEngine(std::make_shared<TranspositionTable>()));
+      engines[i]->setHashSize(config.hash_mb);
+      engines[i]->setNetwork(nets[i], nets[i] != nullptr);
+    }
+
+    for (int g; (g = next.fetch_add(1, std::memory_order_relaxed)) < games;) {
+      // games 2k and 2k+1 share an opening with the colours swapped
+      MatchGame game;
+      game.round = g + 1;
+      game.a_white = g % 2 == 0;
+      const MatchOpening &opening = openings[(g / 2) % openings.size()];
+      ChessEngine &a = *engines[0], &b = *engines[1];
+      if (game.a_white)
+        play_game(a, b, opening, config.limits, game);
+      else
+        play_game(b, a, opening, config.limits, game);
+
+      std::lock_guard<std::mutex> lock(report_mutex);
+      bool white_won = game.result == "1-0", black_won = game.result == "0-1";
+      if (!white_won && !black_won)
+        score.draws++;
+      else if (white_won == game.a_white)
+        score.wins++;
+      else
+        score.losses++;
+      finished++;
+
+      if (pgn.is_open()) {
+        pgn << to_pgn(game, date);
+        pgn.flush();
+      }
+      std::cout << "Game " << game.round << " (" << finished << "/" << games
+                << ", A " << (game.a_white ? "white" : "black")
+                << "): " << game.result << " " << game.reason << ", "
+                << game.plies << " plies | A vs B +" << score.wins << " -"
+                << score.losses << " =" << score.draws << std::fixed
+                << std::setprecision(1) << ", Elo " << score.elo() << " +/- "
+                << score.eloError() << std::endl;
+    }
+  };
+
+  int threads = std::max(1, std::min(config.concurrency, games));
+  std::vector<std::thread> workers;
+  for (int t = 1; t < threads; t++)
+    workers.emplace_back(worker);
+  worker();
+  for (std::thread &t : workers)
+    t.join();
+
+  std::cout << std::fixed << std::setprecision(1) << "\nScore of A vs B: "
+            << score.wins << " - " << score.losses << " - " << score.draws
+            << " [" << std::setprecision(3) << score.score() << "] "
+            << score.games() << "\n"
+            << std::setprecision(1) << "Elo difference: " << score.elo()
+            << " +/- " << score.eloError() << " (95%), LOS "
+            << score.los() * 100 << "%" << std::endl;
+  return true;
+}
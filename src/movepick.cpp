@@ -0,0 +1,159 @@
+#include "movepick.h"
+#include <utility>
+
+// queen promotions go ahead of every capture, as they did under the sort
+static constexpr int QUEEN_PROMO_BONUS = 10'000;
+
+static bool is_tactical(Move m) {
+  MoveFlags f = m.flags();
+  return (f & CAPTURE) || f == PR_QUEEN;
+}
+
+MovePicker::MovePicker(ChessEngine &engine, int ply, Move ttMove,
+                       bool inCheck)
+    : engine(engine), ply(ply), ttMove(ttMove), stage(TT_MOVE),
+      num_captures(0), end(0), cur(0), bad_end(0), in_check(inCheck),
+      quiets_generated(false), num_killers(0), killer(0) {}
+
+bool MovePicker::returned(Move m) const {
+  if (m == ttMove)
+    return true;
+  for (int i = 0; i < num_killers; i++)
+    if (m == killers[i])
+      return true;
+  return false;
+}
+
+void MovePicker::add(Move *buf, int n) {
+  int quiets = 0;
+  for (int i = 0; i < n; i++) {
+    Move m = buf[i];
+    if (returned(m))
+      continue;
+    if (is_tactical(m))
+      moves[num_captures++].move = m;
+    else
+      buf[quiets++] = m;
+  }
+  if (end < num_captures)
+    end = num_captures;
+  for (int i = 0; i < quiets; i++)
+    moves[end++].move = buf[i];
+}
+
+void MovePicker::scoreCaptures() {
+  for (int i = 0; i < num_captures; i++) {
+    Move m = moves[i].move;
+    MoveFlags f = m.flags();
+    int score = engine.getCaptureScore(m);
+    if (f == PR_QUEEN || f == PC_QUEEN)
+      score += QUEEN_PROMO_BONUS;
+    moves[i].score = score;
+  }
+}
+
+void MovePicker::scoreQuiets() {
+  Color side = engine.position.turn();
+  for (int i = num_captures; i < end; i++) {
+    Move m = moves[i].move;
+    moves[i].score = engine.history_table[side][m.from()][m.to()];
+  }
+}
+
+Move MovePicker::selectBest(int last) {
+  int best = cur;
+  for (int i = cur + 1; i < last; i++)
+    if (moves[i].score > moves[best].score)
+      best = i;
+  std::swap(moves[cur], moves[best]);
+  return moves[cur++].move;
+}
+
+bool MovePicker::takeQuiet(Move m) {
+  for (int i = num_captures; i < end; i++) {
+    if (moves[i].move == m) {
+      moves[i] = moves[--end];
+      return true;
+    }
+  }
+  return false;
+}
+
+Move MovePicker::next() {
+  switch (stage) {
+  case TT_MOVE:
+    stage = GEN_CAPTURES;
+    if (ttMove != Move() && engine.position.is_legal(ttMove))
+      return ttMove;
+    ttMove = Move();
+    [[fallthrough]];
+
+  case GEN_CAPTURES: {
+    Move buf[MAX_MOVES];
+    if (in_check) {
+      add(buf, engine.generateEvasionsInto(buf));
+      quiets_generated = true;
+    } else {
+      add(buf, engine.generateCapturesInto(buf));
+    }
+    scoreCaptures();
+    stage = GOOD_CAPTURES;
+    [[fallthrough]];
+  }
+
+  case GOOD_CAPTURES:
+    while (cur < num_captures) {
+      Move m = selectBest(num_captures);
+      // promotions are worth making whatever the exchange on the square
+      if (!(m.flags() & PR_KNIGHT) && engine.see(m) < 0) {
+        moves[bad_end++].move = m;
+        continue;
+      }
+      return m;
+    }
+    stage = KILLERS;
+    [[fallthrough]];
+
+  case KILLERS:
+    while (killer < 2 && ply < MAX_PLY) {
+      Move k = engine.killer_moves[ply][killer++];
+      if (k == Move() || k == ttMove || is_tactical(k))
+        continue;
+      // in check the evasions are already generated, quiets included
+      if (quiets_generated ? takeQuiet(k) : engine.position.is_legal(k)) {
+        killers[num_killers++] = k;
+        return k;
+      }
+    }
+    stage = GEN_QUIETS;
+    [[fallthrough]];
+
+  case GEN_QUIETS:
+    if (!quiets_generated) {
+      Move buf[MAX_MOVES];
+      add(buf, engine.generateQuietsInto(buf));
+      quiets_generated = true;
+    }
+    scoreQuiets();
+    cur = num_captures;
+    stage = QUIETS;
+    [[fallthrough]];
+
+  case QUIETS:
+    if (cur < end)
+      return selectBest(end);
+    cur = 0;
+    stage = BAD_CAPTURES;
+    [[fallthrough]];
+
+  case BAD_CAPTURES:
+    if (cur < bad_end)
+      return moves[cur++].move;
+    stage = DONE;
+    [[fallthrough]];
+
+  case DONE:
+    break;
+  }
+  return Move();
+}
@@ -0,0 +1,173 @@
+#include "nnue.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define NNUE_SIMD_WIDTH 16
+typedef __m256i nnue_vec;
+#define vec_load(p) _mm256_loadu_si256((const __m256i *)(p))
+#define vec_store(p, v) _mm256_storeu_si256((__m256i *)(p), v)
+#define vec_add16(a, b) _mm256_add_epi16(a, b)
+#define vec_sub16(a, b) _mm256_sub_epi16(a, b)
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#define NNUE_SIMD_WIDTH 8
+typedef __m128i nnue_vec;
+#define vec_load(p) _mm_loadu_si128((const __m128i *)(p))
+#define vec_store(p, v) _mm_storeu_si128((__m128i *)(p), v)
+#define vec_add16(a, b) _mm_add_epi16(a, b)
+#define vec_sub16(a, b) _mm_sub_epi16(a, b)
+#endif
+
+#define NNUE_FILE_VERSION 1
+
+struct NnueFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t inputs;
+  uint32_t hidden;
+  uint32_t reserved;
+};
+
+template <typename T>
+static bool read_array(std::ifstream &file, T *dst, size_t n) {
+  return (bool)file.read(reinterpret_cast<char *>(dst),
+                         (std::streamsize)(n * sizeof(T)));
+}
+
+bool NnueNetwork::load(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Could not open network file: " << path << std::endl;
+    return false;
+  }
+
+  NnueFileHeader h{};
+  if (!file.read(reinterpret_cast<char *>(&h), sizeof(h)) ||
+      std::memcmp(h.magic, "CGSNNUE", 7) != 0) {
+    std::cerr << "Not a network file: " << path << std::endl;
+    return false;
+  }
+  if (h.version != NNUE_FILE_VERSION || h.inputs != NNUE_INPUTS ||
+      h.hidden != NNUE_HIDDEN) {
+    std::cerr << "Unsupported network architecture (" << h.inputs << "x"
+              << h.hidden << ", expected " << NNUE_INPUTS << "x" << NNUE_HIDDEN
+              << "): " << path << std::endl;
+    return false;
+  }
+
+  std::unique_ptr<int16_t[]> w(new int16_t[(size_t)NNUE_INPUTS * NNUE_HIDDEN]);
+  std::unique_ptr<int16_t[]> b(new int16_t[NNUE_HIDDEN]);
+  std::unique_ptr<int8_t[]> ow(new int8_t[2 * NNUE_HIDDEN]);
+  int32_t ob = 0;
+  if (!read_array(file, w.get(), (size_t)NNUE_INPUTS * NNUE_HIDDEN) ||
+      !read_array(file, b.get(), NNUE_HIDDEN) ||
+      !read_array(file, ow.get(), 2 * NNUE_HIDDEN) ||
+      !read_array(file, &ob, 1)) {
+    std::cerr << "Truncated network file: " << path << std::endl;
+    return false;
+  }
+  if (file.peek() != std::ifstream::traits_type::eof()) {
+    std::cerr << "Trailing data in network file: " << path << std::endl;
+    return false;
+  }
+
+  ft_weights = std::move(w);
+  ft_bias = std::move(b);
+  out_weights = std::move(ow);
+  out_bias = ob;
+  return true;
+}
+
+void NnueNetwork::refresh(int16_t *acc, const int *features, int n) const {
+  std::memcpy(acc, ft_bias.get(), NNUE_HIDDEN * sizeof(int16_t));
+  for (int f = 0; f < n; f++) {
+    const int16_t *row = &ft_weights[(size_t)features[f] * NNUE_HIDDEN];
+#ifdef NNUE_SIMD_WIDTH
+    for (int i = 0; i < NNUE_HIDDEN; i += NNUE_SIMD_WIDTH)
+      vec_store(acc + i, vec_add16(vec_load(acc + i), vec_load(row + i)));
+#else
+    for (int i = 0; i < NNUE_HIDDEN; i++)
+      acc[i] += row[i];
+#endif
+  }
+}
+
+void NnueNetwork::update(int16_t *out, const int16_t *in,
+                         const NnueDelta &d) const {
+  const int16_t *add[NNUE_MAX_DELTA], *sub[NNUE_MAX_DELTA];
+  for (int k = 0; k < d.num_added; k++)
+    add[k] = &ft_weights[(size_t)d.added[k] * NNUE_HIDDEN];
+  for (int k = 0; k < d.num_removed; k++)
+    sub[k] = &ft_weights[(size_t)d.removed[k] * NNUE_HIDDEN];
+
+  // one pass over the accumulator whatever the number of changed features
+#ifdef NNUE_SIMD_WIDTH
+  for (int i = 0; i < NNUE_HIDDEN; i += NNUE_SIMD_WIDTH) {
+    nnue_vec v = vec_load(in + i);
+    for (int k = 0; k < d.num_added; k++)
+      v = vec_add16(v, vec_load(add[k] + i));
+    for (int k = 0; k < d.num_removed; k++)
+      v = vec_sub16(v, vec_load(sub[k] + i));
+    vec_store(out + i, v);
+  }
+#else
+  for (int i = 0; i < NNUE_HIDDEN; i++) {
+    int16_t v = in[i];
+    for (int k = 0; k < d.num_added; k++)
+      v += add[k][i];
+    for (int k = 0; k < d.num_removed; k++)
+      v -= sub[k][i];
+    out[i] = v;
+  }
+#endif
+}
+
+// clipped relu into uint8, then the dot product with the int8 output weights
+static int32_t output_dot(const int16_t *acc, const int8_t *w) {
+#if defined(__AVX2__)
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i ones = _mm256_set1_epi16(1);
+  __m256i sum = zero;
+  for (int i = 0; i < NNUE_HIDDEN; i += 32) {
+    // packs saturates to 127 and interleaves the 128-bit lanes; the permute
+    // puts them back in weight order
+    __m256i a = _mm256_packs_epi16(vec_load(acc + i), vec_load(acc + i + 16));
+    a = _mm256_permute4x64_epi64(_mm256_max_epi8(a, zero), 0xD8);
+    __m256i prod = _mm256_maddubs_epi16(a, vec_load(w + i));
+    sum = _mm256_add_epi32(sum, _mm256_madd_epi16(prod, ones));
+  }
+  __m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum),
+                            _mm256_extracti128_si256(sum, 1));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+  return _mm_cvtsi128_si32(s);
+#elif defined(__SSE4_1__)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ones = _mm_set1_epi16(1);
+  __m128i sum = zero;
+  for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+    __m128i a = _mm_packs_epi16(vec_load(acc + i), vec_load(acc + i + 8));
+    a = _mm_max_epi8(a, zero);
+    __m128i prod = _mm_maddubs_epi16(a, vec_load(w + i));
+    sum = _mm_add_epi32(sum, _mm_madd_epi16(prod, ones));
+  }
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+  return _mm_cvtsi128_si32(sum);
+#else
+  int32_t sum = 0;
+  for (int i = 0; i < NNUE_HIDDEN; i++)
+    sum += std::clamp<int>(acc[i], 0, NNUE_QA) * w[i];
+  return sum;
+#endif
+}
+
+int NnueNetwork::evaluate(const int16_t *us, const int16_t *them) const {
+  int64_t out = (int64_t)output_dot(us, out_weights.get()) +
+                output_dot(them, out_weights.get() + NNUE_HIDDEN) + out_bias;
+  return (int)(out * NNUE_SCALE / (NNUE_QA * NNUE_QB));
+}
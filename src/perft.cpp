@@ -0,0 +1,305 @@
+#include "perft.h"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+PerftTable::PerftTable(size_t mb) {
+  count = std::max<size_t>(1, mb * 1024 * 1024 / sizeof(PerftSlot));
+  slots.reset(new PerftSlot[count]());
+}
+
+static inline uint64_t load_word(uint64_t &w) {
+  return std::atomic_ref<uint64_t>(w).load(std::memory_order_relaxed);
+}
+
+static inline void store_word(uint64_t &w, uint64_t v) {
+  std::atomic_ref<uint64_t>(w).store(v, std::memory_order_relaxed);
+}
+
+// data packs the count above the depth; counts stay far below 2^56
+bool PerftTable::probe(uint64_t key, int depth, uint64_t &nodes) const {
+  PerftSlot &s = slots[((key >> 32) * count) >> 32];
+  uint64_t data = load_word(s.data);
+  if ((load_word(s.check) ^ data) != key || (int)(data & 0xff) != depth)
+    return false;
+  nodes = data >> 8;
+  return true;
+}
+
+void PerftTable::store(uint64_t key, int depth, uint64_t nodes) {
+  PerftSlot &s = slots[((key >> 32) * count) >> 32];
+  uint64_t data = nodes << 8 | (uint64_t)depth;
+  store_word(s.check, key ^ data);
+  store_word(s.data, data);
+}
+
+// the position hash leaves out castling rights and the ep square, both of
+// which change the counts below a node
+static uint64_t table_key(const PositionManager &p) {
+  const UndoInfo &st = p.history[p.ply()];
+  // multiplying by an odd constant maps distinct rights to distinct words
+  uint64_t key = p.get_hash() ^ (st.entry & ALL_CASTLING_MASK) * 0x9E3779B97F4A7C15ULL;
+  if (st.epsq != NO_SQ)
+    key ^= std::rotl(zobrist::zobrist_ep[file_of(st.epsq)], 32);
+  return key;
+}
+
+template <Color Us>
+static uint64_t perft_node(PositionManager &p, int depth, PerftTable *table) {
+  if (depth <= 0)
+    return 1;
+
+  uint64_t key = 0;
+  if (table && depth > 1) {
+    uint64_t nodes;
+    key = table_key(p);
+    if (table->probe(key, depth, nodes))
+      return nodes;
+  }
+
+  MoveList<Us> list(p);
+  if (depth == 1)
+    return list.size();
+
+  uint64_t nodes = 0;
+  for (Move m : list) {
+    p.play<Us>(m);
+    p.flip_side_hash();
+    nodes += perft_node<~Us>(p, depth - 1, table);
+    p.flip_side_hash();
+    p.undo<Us>(m);
+  }
+
+  if (table)
+    table->store(key, depth, nodes);
+  return nodes;
+}
+
+template <Color Us> static std::vector<Move> root_moves(PositionManager &p) {
+  MoveList<Us> list(p);
+  return std::vector<Move>(list.begin(), list.end());
+}
+
+template <Color Us>
+static uint64_t perft_after(PositionManager &p, Move m, int depth,
+                            PerftTable *table) {
+  p.play<Us>(m);
+  p.flip_side_hash();
+  uint64_t nodes = perft_node<~Us>(p, depth - 1, table);
+  p.flip_side_hash();
+  p.undo<Us>(m);
+  return nodes;
+}
+
+uint64_t perft(PositionManager &p, int depth, PerftTable *table) {
+  return p.turn() == WHITE ? perft_node<WHITE>(p, depth, table)
+                           : perft_node<BLACK>(p, depth, table);
+}
+
+uint64_t perft_parallel(const PositionManager &root, int depth, int threads,
+                        PerftTable *table, std::vector<PerftDivide> *divide) {
+  if (depth <= 0)
+    return 1;
+
+  // a position is tens of kilobytes of history, so it lives on the heap.
+  // Copies are assigned, not constructed: UndoInfo's copy constructor
+  // starts the next ply rather than duplicating one.
+  auto copy_root = [&root] {
+    std::unique_ptr<PositionManager> pos(new PositionManager());
+    *pos = root;
+    return pos;
+  };
+  std::unique_ptr<PositionManager> p = copy_root();
+  const std::vector<Move> moves = p->turn() == WHITE ? root_moves<WHITE>(*p)
+                                                     : root_moves<BLACK>(*p);
+  const int n = (int)moves.size();
+
+  std::vector<uint64_t> counts(n, 1);
+  if (depth > 1) {
+    std::atomic<int> next{0};
+    auto worker = [&](PositionManager &pos) {
+      for (int i; (i = next.fetch_add(1, std::memory_order_relaxed)) < n;)
+        counts[i] = pos.turn() == WHITE
+                        ? perft_after<WHITE>(pos, moves[i], depth, table)
+                        : perft_after<BLACK>(pos, moves[i], depth, table);
+    };
+
+    threads = std::max(1, std::min(threads, n));
+    std::vector<std::unique_ptr<PositionManager>> positions;
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; t++) {
+      positions.push_back(copy_root());
+      workers.emplace_back(worker, std::ref(*positions.back()));
+    }
+    worker(*p);
+    for (std::thread &t : workers)
+      t.join();
+  }
+
+  uint64_t total = 0;
+  for (int i = 0; i < n; i++) {
+    total += counts[i];
+    if (divide)
+      divide->push_back({moves[i], counts[i]});
+  }
+  return total;
+}
+
+struct SuiteCase {
+  int line;
+  std::string fen;
+  std::vector<std::pair<int, uint64_t>> expected;
+  std::vector<uint64_t> counts;
+  bool valid = false;
+  double time_ms = 0;
+};
+
+// "<fen> ;D1 20 ;D2 400 ..."; false for lines that are not a suite entry
+static bool parse_suite_line(const std::string &line, SuiteCase &c,
+                             int max_depth) {
+  size_t semi = line.find(';');
+  if (semi == std::string::npos)
+    return false;
+  c.fen = line.substr(0, semi);
+  c.fen.erase(c.fen.find_last_not_of(" \t") + 1);
+
+  std::istringstream fields(line.substr(semi + 1));
+  std::string field;
+  while (std::getline(fields, field, ';')) {
+    std::istringstream f(field);
+    std::string tag;
+    uint64_t nodes;
+    if (!(f >> tag >> nodes) || tag.size() < 2 || tag[0] != 'D')
+      return false;
+    int depth = std::atoi(tag.c_str() + 1);
+    if (depth < 1)
+      return false;
+    if (max_depth <= 0 || depth <= max_depth)
+      c.expected.push_back({depth, nodes});
+  }
+  return !c.fen.empty();
+}
+
+static bool report_case(const SuiteCase &c) {
+  std::cout << "FEN: " << c.fen << "\n";
+  if (!c.valid) {
+    std::cout << "  line " << c.line << ": not a playable position  FAIL\n";
+    return false;
+  }
+  bool ok = true;
+  for (size_t i = 0; i < c.expected.size(); i++) {
+    bool pass = c.counts[i] == c.expected[i].second;
+    std::cout << "  D" << c.expected[i].first << " " << c.counts[i];
+    if (pass)
+      std::cout << "  PASS\n";
+    else
+      std::cout << "  FAIL (expected " << c.expected[i].second << ")\n";
+    ok = ok && pass;
+  }
+  std::cout << "  " << (uint64_t)c.time_ms << " ms\n";
+  return ok;
+}
+
+bool run_perft_suite(const std::string &path, int threads, int max_depth) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    std::cerr << "Could not open perft suite: " << path << std::endl;
+    return false;
+  }
+
+  std::vector<SuiteCase> cases;
+  std::string line;
+  int line_no = 0;
+  bool parsed = true;
+  while (std::getline(file, line)) {
+    line_no++;
+    if (line.empty() || line[0] == '#' ||
+        line.find_first_not_of(" \t\r") == std::string::npos)
+      continue;
+    SuiteCase c;
+    c.line = line_no;
+    if (!parse_suite_line(line, c, max_depth)) {
+      std::cerr << path << ":" << line_no << ": not a perft entry"
+                << std::endl;
+      parsed = false;
+      continue;
+    }
+    cases.push_back(std::move(c));
+  }
+  if (cases.empty()) {
+    std::cerr << "No perft entries in " << path << std::endl;
+    return false;
+  }
+
+  const int n = (int)cases.size();
+  std::atomic<int> next{0};
+  std::atomic<uint64_t> total_nodes{0};
+
+  // results print in file order: whoever finishes the next unprinted case
+  // prints it and any finished cases queued behind it
+  std::mutex print_mutex;
+  std::vector<char> done(n, 0);
+  int printed = 0;
+  int failed = 0;
+  int depths_run = 0, depths_passed = 0;
+
+  auto worker = [&] {
+    std::unique_ptr<PositionManager> p(new PositionManager());
+    for (int i; (i = next.fetch_add(1, std::memory_order_relaxed)) < n;) {
+      SuiteCase &c = cases[i];
+      // set() trusts its input, so nothing malformed may reach it
+      c.valid = PositionManager::is_valid_fen(c.fen);
+      if (c.valid)
+        PositionManager::set(c.fen, *p);
+      auto start = std::chrono::steady_clock::now();
+      if (c.valid) {
+        for (const auto &[depth, expected] : c.expected) {
+          c.counts.push_back(perft(*p, depth));
+          total_nodes.fetch_add(c.counts.back(), std::memory_order_relaxed);
+        }
+      }
+      c.time_ms = std::chrono::duration<double, std::milli>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+
+      std::lock_guard<std::mutex> lock(print_mutex);
+      done[i] = 1;
+      for (; printed < n && done[printed]; printed++) {
+        const SuiteCase &r = cases[printed];
+        if (!report_case(r))
+          failed++;
+        for (size_t k = 0; k < r.counts.size(); k++) {
+          depths_run++;
+          depths_passed += r.counts[k] == r.expected[k].second;
+        }
+      }
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  threads = std::max(1, std::min(threads, n));
+  std::vector<std::thread> workers;
+  for (int t = 1; t < threads; t++)
+    workers.emplace_back(worker);
+  worker();
+  for (std::thread &t : workers)
+    t.join();
+  double time_ms = std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  uint64_t nodes = total_nodes.load();
+  std::cout << "\nPassed " << depths_passed << "/" << depths_run
+            << " depths, " << (n - failed) << "/" << n << " positions\n"
+            << "Nodes: " << nodes << "  Time: " << (uint64_t)time_ms
+            << " ms  NPS: "
+            << (uint64_t)(time_ms > 0 ? nodes * 1000.0 / time_ms : 0) << "  ("
+            << threads << " thread(s))" << std::endl;
+  return parsed && failed == 0;
+}
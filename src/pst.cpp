@@ -1,6 +1,6 @@
 #include "pst.h"
 
-const int MG_PAWN_PST[64] = {
+constexpr int MG_PAWN_PST[64] = {
   0,   0,   0,   0,   0,   0,   0,   0,
   50,  50,  50,  50,  50,  50,  50,  50,
   10,  10,  20,  30,  30,  20,  10,  10,
@@ -11,7 +11,7 @@ const int MG_PAWN_PST[64] = {
   0,   0,   0,   0,   0,   0,   0,   0
 };
 
-const int EG_PAWN_PST[64] = {
+constexpr int EG_PAWN_PST[64] = {
   0,    0,   0,   0,   0,   0,   0,   0,
   80,  80,  80,  80,  80,  80,  80,  80,
   50,  50,  50,  50,  50,  50,  50,  50,
@@ -22,7 +22,7 @@ const int EG_PAWN_PST[64] = {
    0,   0,   0,   0,   0,   0,   0,   0
 };
 
-const int MG_KNIGHT_PST[64] = {
+constexpr int MG_KNIGHT_PST[64] = {
   -50, -40, -30, -30, -30, -30, -40, -50,
   -40, -20,   0,   0,   0,   0, -20, -40,
   -30,   0,  10,  15,  15,  10,   0, -30,
@@ -33,7 +33,7 @@ const int MG_KNIGHT_PST[64] = {
   -50, -40, -30, -30, -30, -30, -40, -50
 };
 
-const int EG_KNIGHT_PST[64] = {
+constexpr int EG_KNIGHT_PST[64] = {
   -40, -30, -20, -20, -20, -20, -30, -40,
   -30, -10,   0,   5,   5,   0, -10, -30,
   -20,   5,  10,  15,  15,  10,   5, -20,
@@ -44,7 +44,7 @@ const int EG_KNIGHT_PST[64] = {
   -40, -30, -20, -20, -20, -20, -30, -40
 };
 
-const int MG_BISHOP_PST[64] = {
+constexpr int MG_BISHOP_PST[64] = {
   -20, -10, -10, -10, -10, -10, -10, -20,
   -10,   5,   0,   0,   0,   0,   5, -10,
   -10,  10,  10,  10,  10,  10,  10, -10,
@@ -55,7 +55,7 @@ const int MG_BISHOP_PST[64] = {
   -20, -10, -10, -10, -10, -10, -10, -20
 };
 
-const int EG_BISHOP_PST[64] = {
+constexpr int EG_BISHOP_PST[64] = {
   -10, -10, -10, -10, -10, -10, -10, -10,
   -10,  10,   0,   0,   0,   0,  10, -10,
   -10,   0,  10,  10,  10,  10,   0, -10,
@@ -66,7 +66,7 @@ const int EG_BISHOP_PST[64] = {
   -10, -10, -10, -10, -10, -10, -10, -10
 };
 
-const int MG_ROOK_PST[64] = {
+constexpr int MG_ROOK_PST[64] = {
   0,   0,   5,  10,  10,   5,   0,   0,
   -5,   0,   0,   0,   0,   0,   0,  -5,
   -5,   0,   0,   0,   0,   0,   0,  -5,
@@ -77,7 +77,7 @@ const int MG_ROOK_PST[64] = {
    0,   0,   0,   0,   0,   0,   0,   0
 };
 
-const int EG_ROOK_PST[64] = {
+constexpr int EG_ROOK_PST[64] = {
    0,   0,   5,  10,  10,   5,   0,   0,
    5,  10,  10,  10,  10,  10,  10,   5,
    0,   0,   0,   0,   0,   0,   0,   0,
@@ -88,7 +88,7 @@ const int EG_ROOK_PST[64] = {
    0,   0,   0,   0,   0,   0,   0,   0
 };
 
-const int MG_QUEEN_PST[64] = {
+constexpr int MG_QUEEN_PST[64] = {
   -20, -10, -10,  -5,  -5, -10, -10, -20,
   -10,   0,   5,   0,   0,   0,   0, -10,
   -10,   5,   5,   5,   5,   5,   0, -10,
@@ -99,7 +99,7 @@ const int MG_QUEEN_PST[64] = {
   -20, -10, -10,  -5,  -5, -10, -10, -20
 };
 
-const int EG_QUEEN_PST[64] = {
+constexpr int EG_QUEEN_PST[64] = {
   -10, -10, -10, -10, -10, -10, -10, -10,
    -5,   0,   0,   0,   0,   0,   0,  -5,
    -5,   0,   5,   5,   5,   5,   0,  -5,
@@ -110,7 +110,7 @@ const int EG_QUEEN_PST[64] = {
   -10, -10, -10, -10, -10, -10, -10, -10
 };
 
-const int MG_KING_PST[64] = {
+constexpr int MG_KING_PST[64] = {
   -30, -40, -40, -50, -50, -40, -40, -30,
   -30, -40, -40, -50, -50, -40, -40, -30,
   -30, -40, -40, -50, -50, -40, -40, -30,
@@ -121,7 +121,7 @@ const int MG_KING_PST[64] = {
    20,  30,  10,   0,   0,  10,  30,  20
 };
 
-const int EG_KING_PST[64] = {
+constexpr int EG_KING_PST[64] = {
   -50, -40, -30, -20, -20, -30, -40, -50,
   -30, -20, -10,   0,   0, -10, -20, -30,
   -30, -10,  20,  30,  30,  20, -10, -30,
@@ -130,4 +130,35 @@ const int EG_KING_PST[64] = {
   -30, -10,  20,  30,  30,  20, -10, -30,
   -30, -30,   0,   0,   0,   0, -30, -30,
   -50, -30, -30, -30, -30, -30, -30, -50
-};
\ No newline at end of file
+};
+
+static constexpr PsqTable build_psq() {
+  constexpr int value[NPIECE_TYPES] = {PAWN_VALUE, KNIGHT_VALUE, BISHOP_VALUE,
+                                       ROOK_VALUE, QUEEN_VALUE, 0};
+  constexpr int phase[NPIECE_TYPES] = {0, PHASE_KNIGHT, PHASE_BISHOP,
+                                       PHASE_ROOK, PHASE_QUEEN, 0};
+  constexpr const int *mg[NPIECE_TYPES] = {MG_PAWN_PST,  MG_KNIGHT_PST,
+                                           MG_BISHOP_PST, MG_ROOK_PST,
+                                           MG_QUEEN_PST, MG_KING_PST};
+  constexpr const int *eg[NPIECE_TYPES] = {EG_PAWN_PST,  EG_KNIGHT_PST,
+                                           EG_BISHOP_PST, EG_ROOK_PST,
+                                           EG_QUEEN_PST, EG_KING_PST};
+
+  PsqTable t{};
+  for (Color c : {WHITE, BLACK}) {
+    int sign = c == WHITE ? 1 : -1;
+    for (int pt = PAWN; pt <= KING; pt++) {
+      Piece pc = make_piece(c, PieceType(pt));
+      t.phase[pc] = phase[pt];
+      for (int sq = 0; sq < 64; sq++) {
+        // the tables are laid out rank 8 first, from white's side
+        int idx = c == WHITE ? sq ^ 56 : sq;
+        t.mg[pc][sq] = sign * (value[pt] + mg[pt][idx]);
+        t.eg[pc][sq] = sign * eg[pt][idx];
+      }
+    }
+  }
+  return t;
+}
+
+constexpr PsqTable PSQ = build_psq();
@@ -1,5 +1,5 @@
 #include "engine.h"
-#include <SDL3/SDL.h>
+#include "movepick.h"
 #include <algorithm>
 #include <chrono>
 #include <cmath>
@@ -9,7 +9,8 @@
 #include <random>
 #include <sstream>
 
-static constexpr int MATE_SCORE = 100000;
+// fits the 16-bit score field of a transposition table entry
+static constexpr int MATE_SCORE = 32000;
 static constexpr int INF = 1000000;
 static constexpr int MATE_BOUND = MATE_SCORE - MAX_PLY;
 
@@ -55,44 +56,24 @@ void ChessEngine::initLmrTable() {
 
 void ChessEngine::ttStore(uint64_t key, int depth, int score, TTBound bound,
                           Move bestMove, int ply) {
-  TTEntry &e = tt[key & TT_MASK];
-
-  bool replace;
-  if (e.key == 0) {
-    replace = true;
-  } else if (e.age != tt_age) {
-    replace = true;
-  } else if (e.key == key) {
-    if (e.depth > depth && e.bound == TT_EXACT && bound != TT_EXACT)
-      return;
-    replace = true;
-  } else {
-    replace = depth >= e.depth - 2;
-  }
-
-  if (!replace)
-    return;
-
-  e.key = key;
-  e.depth = static_cast<int8_t>(std::max(-128, std::min(127, depth)));
-  e.score = static_cast<int16_t>(scoreToTT(score, ply));
-  e.bound = static_cast<uint8_t>(bound);
-  e.bestMove = bestMove;
-  e.age = tt_age;
+  tt->store(key, depth, scoreToTT(score, ply), bound, bestMove);
 }
 
 bool ChessEngine::ttProbe(uint64_t key, int depth, int alpha, int beta, int ply,
                           int &score, Move &bestMove) {
-  const TTEntry &e = tt[key & TT_MASK];
-  if (e.key != key)
+  TTEntry e;
+  if (!tt->probe(key, e))
     return false;
 
-  bestMove = e.bestMove;
-  if (e.depth < depth)
+  searchStats.hash_hits++;
+  // a 16-bit key check lets another position's entry through now and then;
+  // its move must at least fit this board before ordering sees it
+  bestMove = position.is_pseudo_legal(e.bestMove) ? e.bestMove : Move();
+  if (e.depth() < depth)
     return false;
 
   int s = scoreFromTT(e.score, ply);
-  switch (e.bound) {
+  switch (e.bound()) {
   case TT_EXACT:
     score = s;
     return true;
@@ -228,52 +209,34 @@ int ChessEngine::see(const Move &move) {
   return gain[0];
 }
 
-void ChessEngine::orderMovesInto(const Move *moves, int n, int ply, Move ttMove,
-                                 ScoredMove *out) {
-  Color side = position.turn();
+template <GenType Type>
+static int generate_into(PositionManager &position, Move *buf) {
+  Move *end = position.turn() == WHITE
+                  ? position.generate_legals<WHITE, Type>(buf)
+                  : position.generate_legals<BLACK, Type>(buf);
+  return (int)(end - buf);
+}
 
-  for (int i = 0; i < n; i++) {
-    const Move &move = moves[i];
-    int score = 0;
+int ChessEngine::generateLegalMovesInto(Move *buf) {
+  return generate_into<GEN_ALL>(position, buf);
+}
 
-    if (ttMove != Move() && move == ttMove) {
-      score = 1'000'000;
-    } else if (move.flags() == PR_QUEEN || move.flags() == PC_QUEEN) {
-      score = 250'000;
-    } else if (move.is_capture()) {
-      score = 200'000 + getCaptureScore(move);
-    } else if (move.flags() >= PR_KNIGHT && move.flags() <= PR_ROOK) {
-      score = 110'000 + (move.flags() - PR_KNIGHT) * 100;
-    } else if (ply < MAX_PLY && move == killer_moves[ply][0]) {
-      score = 100'000;
-    } else if (ply < MAX_PLY && move == killer_moves[ply][1]) {
-      score = 90'000;
-    } else {
-      score = history_table[side][move.from()][move.to()];
-    }
-    out[i] = {move, score};
-  }
+int ChessEngine::generateCapturesInto(Move *buf) {
+  return generate_into<GEN_CAPTURES>(position, buf);
+}
 
-  std::sort(out, out + n, [](const ScoredMove &a, const ScoredMove &b) {
-    return a.score > b.score;
-  });
+int ChessEngine::generateQuietsInto(Move *buf) {
+  return generate_into<GEN_QUIETS>(position, buf);
 }
 
-int ChessEngine::generateLegalMovesInto(Move *buf) {
-  if (position.turn() == WHITE) {
-    Move *end = position.generate_legals<WHITE>(buf);
-    return (int)(end - buf);
-  } else {
-    Move *end = position.generate_legals<BLACK>(buf);
-    return (int)(end - buf);
-  }
+int ChessEngine::generateEvasionsInto(Move *buf) {
+  return generate_into<GEN_EVASIONS>(position, buf);
 }
 
 void ChessEngine::clearTables() {
   std::memset(history_table, 0, sizeof(history_table));
   clearKillers();
-  std::memset(tt.data(), 0, tt.size() * sizeof(TTEntry));
-  tt_age = 0;
+  tt->clear(num_threads);
 }
 
 void ChessEngine::clearKillers() {
@@ -340,11 +303,13 @@ bool ChessEngine::isDrawByInsufficientMaterial() const {
 }
 
 bool ChessEngine::checkTimeUp() {
+  if (node_limit && (uint64_t)searchStats.nodes >= node_limit)
+    time_up_flag = true;
   if (allocated_time_ms == 0)
-    return false;
+    return time_up_flag;
   if ((searchStats.nodes & (nodes_between_checks - 1)) == 0) {
-    if ((Sint32)(SDL_GetTicks() - start_time) >
-        (Sint32)(allocated_time_ms * 0.8)) {
+    if ((int32_t)(now_ms() - start_time) >
+        (int32_t)(allocated_time_ms * 0.8)) {
       time_up_flag = true;
       return true;
     }
@@ -377,14 +342,9 @@ int ChessEngine::search(int depth, int ply, int alpha, int beta, bool nullPrune,
   uint64_t hash = position.get_hash();
   Move ttMove;
   int ttScore;
-  if (!isPv && ttProbe(hash, depth, alpha, beta, ply, ttScore, ttMove)) {
+  if (ttProbe(hash, depth, alpha, beta, ply, ttScore, ttMove) && !isPv) {
     searchStats.hash_used++;
-    searchStats.hash_hits++;
     return ttScore;
-  } else {
-    const TTEntry &e = tt[hash & TT_MASK];
-    if (e.key == hash)
-      ttMove = e.bestMove;
   }
 
   if (depth <= 0) {
@@ -396,15 +356,16 @@ int ChessEngine::search(int depth, int ply, int alpha, int beta, bool nullPrune,
   if (nullPrune && !isPv && depth >= 3 && !inCheck &&
       non_pawn_material(getSideToMove()) > 0) {
     Square savedEp = position.history[position.game_ply].epsq;
-    Bitboard savedEntry = position.history[position.game_ply].entry;
 
     position.flip_side_hash();
     position.xor_ep_hash(savedEp);
+    tt->prefetch(position.get_hash());
     position.side_to_play = ~position.side_to_play;
     position.game_ply++;
-    position.history[position.game_ply] = UndoInfo();
-    position.history[position.game_ply].entry = savedEntry;
-    position.history[position.game_ply].epsq = NO_SQ;
+    position.history[position.game_ply] =
+        UndoInfo(position.history[position.game_ply - 1]);
+    position.history[position.game_ply].halfmove_clock = 0;
+    position.set_check_info();
 
     repetition_history.push_back(position.get_hash());
 
@@ -426,30 +387,24 @@ int ChessEngine::search(int depth, int ply, int alpha, int beta, bool nullPrune,
     }
   }
 
-  Move moves[MAX_MOVES];
-  int n = generateLegalMovesInto(moves);
-
-  if (n == 0) {
-    if (inCheck)
-      return -MATE_SCORE + ply;
-    return 0;
-  }
-
-  ScoredMove scored[MAX_MOVES];
-  orderMovesInto(moves, n, ply, ttMove, scored);
+  MovePicker picker(*this, ply, ttMove, inCheck);
 
   int old_alpha = alpha;
   Move currentBestMove;
   int bestScore = -INF;
+  int moveCount = 0;
 
-  for (int i = 0; i < n; i++) {
-    const Move &m = scored[i].move;
+  while (true) {
+    const Move m = picker.next();
+    if (m == Move())
+      break;
+    int i = moveCount++;
     bool isCapture = m.is_capture();
     bool isPromotion = (m.flags() >= PR_KNIGHT && m.flags() <= PR_QUEEN) ||
                        (m.flags() >= PC_KNIGHT && m.flags() <= PC_QUEEN);
 
+    bool givesCheck = position.gives_check(m);
     makeMove(m);
-    bool givesCheck = isInCheck(getSideToMove());
     searchStats.moves_searched++;
 
     int evaluation;
@@ -510,6 +465,12 @@ int ChessEngine::search(int depth, int ply, int alpha, int beta, bool nullPrune,
     }
   }
 
+  if (moveCount == 0) {
+    if (inCheck)
+      return -MATE_SCORE + ply;
+    return 0;
+  }
+
   TTBound bound = (alpha > old_alpha) ? TT_EXACT : TT_UPPER;
   ttStore(hash, depth, bestScore, bound, currentBestMove, ply);
   return bestScore;
@@ -517,31 +478,21 @@ int ChessEngine::search(int depth, int ply, int alpha, int beta, bool nullPrune,
 
 int ChessEngine::quiescence_search(int alpha, int beta, int qdepth) {
   if (qdepth >= MAX_Q_DEPTH || checkTimeUp())
-    return eval();
+    return cachedEval();
   searchStats.nodes++;
   searchStats.qnodes++;
   search_progress.nodes.store(searchStats.nodes, std::memory_order_relaxed);
   search_progress.qnodes.store(searchStats.qnodes, std::memory_order_relaxed);
 
-  int stand_pat = eval();
+  int stand_pat = cachedEval();
 
   if (stand_pat >= beta)
     return stand_pat;
   if (stand_pat > alpha)
     alpha = stand_pat;
 
-  Move moves[MAX_MOVES];
-  int n = generateLegalMovesInto(moves);
-
   Move captures[MAX_MOVES];
-  int cn = 0;
-  for (int i = 0; i < n; i++) {
-    const Move &m = moves[i];
-    if (m.is_capture())
-      captures[cn++] = m;
-    else if (m.flags() == PR_QUEEN)
-      captures[cn++] = m;
-  }
+  int cn = generateCapturesInto(captures);
 
   std::sort(captures, captures + cn, [this](const Move &a, const Move &b) {
     return getCaptureScore(a) > getCaptureScore(b);
@@ -592,197 +543,22 @@ int ChessEngine::quiescence_search(int alpha, int beta, int qdepth) {
   return alpha;
 }
 
-Move ChessEngine::getBestMove(int maxDepth) {
-  Move bookMove = getOpeningBookMove();
-  if (bookMove != Move())
-    return bookMove;
-
-  {
-    std::lock_guard<std::mutex> lk(iteration_log_mutex);
-    iteration_log.clear();
-  }
-
-  start_time = SDL_GetTicks();
-  allocated_time_ms = 0;
-  time_up_flag = false;
-
-  clearKillers();
-  tt_age = (uint8_t)(tt_age + 1);
-  if (tt_age == 0)
-    tt_age = 1; 
-
-  search_progress.active.store(true, std::memory_order_relaxed);
-  search_progress.start_ms.store(start_time, std::memory_order_relaxed);
-  search_progress.depth.store(0, std::memory_order_relaxed);
-  search_progress.completed_depth.store(0, std::memory_order_relaxed);
-  search_progress.nodes.store(0, std::memory_order_relaxed);
-  search_progress.qnodes.store(0, std::memory_order_relaxed);
-  search_progress.hash_hits.store(0, std::memory_order_relaxed);
-  search_progress.fail_high.store(0, std::memory_order_relaxed);
-  search_progress.fail_high_first.store(0, std::memory_order_relaxed);
-
+Move ChessEngine::iterativeDeepening(int maxDepth, int startDepth) {
+  maxDepth = std::min(maxDepth, MAX_B_DEPTH);
   Move bestMove;
   int bestScore = -INF;
 
-  for (int depth = 1; depth <= maxDepth; depth++) {
-    search_progress.depth.store(depth, std::memory_order_relaxed);
-
-    int alpha, beta;
-    int window;
-    if (depth >= ASP_MIN_DEPTH && std::abs(bestScore) < MATE_BOUND) {
-      window = ASP_INITIAL_WINDOW;
-      alpha = bestScore - window;
-      beta = bestScore + window;
-    } else {
-      window = INF;
-      alpha = -INF;
-      beta = INF;
-    }
-
-    Move iterationBestMove;
-    int iterationBestScore = -INF;
-    bool iterationOk = false;
-
-    while (true) {
-      Move moves[MAX_MOVES];
-      int n = generateLegalMovesInto(moves);
-      if (n == 0)
-        return Move();
-
-      if (bestMove != Move()) {
-        for (int i = 0; i < n; i++) {
-          if (moves[i] == bestMove) {
-            std::swap(moves[0], moves[i]);
-            break;
-          }
-        }
-      }
-
-      iterationBestMove = Move();
-      iterationBestScore = -INF;
-      int rootAlpha = alpha;
-
-      bool first = true;
-      for (int i = 0; i < n; i++) {
-        const Move &move = moves[i];
-        makeMove(move);
-        int evaluation;
-        if (first) {
-          evaluation =
-              -search(depth - 1, 1, -beta, -rootAlpha, true, true);
-        } else {
-          evaluation =
-              -search(depth - 1, 1, -rootAlpha - 1, -rootAlpha, true, false);
-          if (evaluation > rootAlpha && evaluation < beta) {
-            evaluation =
-                -search(depth - 1, 1, -beta, -rootAlpha, true, true);
-          }
-        }
-        unmakeMove();
-
-        if (evaluation > iterationBestScore) {
-          iterationBestScore = evaluation;
-          iterationBestMove = move;
-          if (evaluation > rootAlpha)
-            rootAlpha = evaluation;
-        }
-        first = false;
-      }
-
-      if (iterationBestScore <= alpha) {
-        window *= 2;
-        alpha = std::max(-INF, iterationBestScore - window);
-        if (window > 4 * ASP_INITIAL_WINDOW) {
-          alpha = -INF;
-          beta = INF;
-        }
-        continue;
-      }
-      if (iterationBestScore >= beta) {
-        window *= 2;
-        beta = std::min(INF, iterationBestScore + window);
-        if (window > 4 * ASP_INITIAL_WINDOW) {
-          alpha = -INF;
-          beta = INF;
-        }
-        continue;
-      }
-      iterationOk = true;
-      break;
-    }
-
-    if (!iterationOk)
-      break;
-
-    bestMove = iterationBestMove;
-    bestScore = iterationBestScore;
-    last_search_depth = depth;
-    last_score = bestScore;
-
-    search_progress.completed_depth.store(depth, std::memory_order_relaxed);
-    search_progress.score_cp.store(bestScore, std::memory_order_relaxed);
-    search_progress.hash_hits.store(searchStats.hash_hits,
-                                    std::memory_order_relaxed);
-    search_progress.fail_high.store(searchStats.fail_high,
-                                    std::memory_order_relaxed);
-    search_progress.fail_high_first.store(searchStats.fail_high_first,
-                                          std::memory_order_relaxed);
-
-    {
-      IterationInfo info;
-      info.depth = depth;
-      info.score_cp = bestScore;
-      info.nodes = (uint64_t)searchStats.nodes;
-      info.time_ms = SDL_GetTicks() - start_time;
-      info.pv = moveToUCI(bestMove);
-      info.hash_hit_pct = safe_pct(searchStats.hash_hits, searchStats.nodes);
-      info.fail_high_first_pct =
-          safe_pct(searchStats.fail_high_first, searchStats.fail_high);
-      info.effective_branching_x100 =
-          searchStats.nodes == 0
-              ? 0
-              : (int)((uint64_t)searchStats.moves_searched * 100 /
-                      searchStats.nodes);
-      std::lock_guard<std::mutex> lk(iteration_log_mutex);
-      iteration_log.push_back(std::move(info));
-    }
-
-    if (std::abs(bestScore) > MATE_BOUND)
-      break;
-  }
-  search_progress.active.store(false, std::memory_order_relaxed);
-
-  return bestMove;
-}
+  root_scores.clear();
 
-Move ChessEngine::getBestMoveWithTime(int time_ms) {
-  Move bookMove = getOpeningBookMove();
-  if (bookMove != Move())
-    return bookMove;
-
-  {
-    std::lock_guard<std::mutex> lk(iteration_log_mutex);
-    iteration_log.clear();
-  }
-
-  start_time = SDL_GetTicks();
-  allocated_time_ms = time_ms;
-  time_up_flag = false;
-
-  clearKillers();
-  tt_age = (uint8_t)(tt_age + 1);
-  if (tt_age == 0)
-    tt_age = 1;
-
-  Move bestMove;
-  int bestScore = -INF;
-
-  for (int depth = 1; depth <= MAX_B_DEPTH; depth++) {
+  for (int depth = startDepth; depth <= maxDepth; depth++) {
     if (time_up_flag)
       break;
 
-    Uint32 elapsed = SDL_GetTicks() - start_time;
-    if (depth > 1 && elapsed > (Uint32)(time_ms / 2))
+    search_progress.depth.store(depth, std::memory_order_relaxed);
+
+    uint32_t elapsed = now_ms() - start_time;
+    if (allocated_time_ms > 0 && depth > 1 &&
+        elapsed > (uint32_t)(allocated_time_ms / 2))
       break;
 
     int alpha, beta;
@@ -800,12 +576,18 @@ Move ChessEngine::getBestMoveWithTime(int time_ms) {
     Move iterationBestMove;
     int iterationBestScore = -INF;
     bool depth_completed = false;
+    RootMoveScore scores[MAX_MOVES];
+    int scored = 0;
 
     while (true) {
       Move moves[MAX_MOVES];
       int n = generateLegalMovesInto(moves);
-      if (n == 0)
+      if (n == 0) {
+        last_search_depth = 0;
+        last_score = isInCheck(position.turn()) ? -MATE_SCORE : 0;
+        last_bound = TT_EXACT;
         return Move();
+      }
 
       if (bestMove != Move()) {
         for (int i = 0; i < n; i++) {
@@ -820,10 +602,12 @@ Move ChessEngine::getBestMoveWithTime(int time_ms) {
       iterationBestScore = -INF;
       int rootAlpha = alpha;
       bool aborted = false;
+      scored = 0;
 
       bool first = true;
       for (int i = 0; i < n; i++) {
         const Move &move = moves[i];
+        const int moveAlpha = rootAlpha;
         makeMove(move);
         int evaluation;
         if (first) {
@@ -844,6 +628,11 @@ Move ChessEngine::getBestMoveWithTime(int time_ms) {
           break;
         }
 
+        TTBound bound = evaluation <= moveAlpha ? TT_UPPER
+                        : evaluation >= beta    ? TT_LOWER
+                                                : TT_EXACT;
+        scores[scored++] = {move, evaluation, bound};
+
         if (evaluation > iterationBestScore) {
           iterationBestScore = evaluation;
           iterationBestMove = move;
@@ -880,11 +669,14 @@ Move ChessEngine::getBestMoveWithTime(int time_ms) {
       break;
     }
 
-    if (depth_completed || depth == 1) {
+    // an aborted first iteration still beats returning no move at all
+    if (depth_completed || (depth == startDepth && iterationBestMove != Move())) {
       bestMove = iterationBestMove;
       bestScore = iterationBestScore;
       last_search_depth = depth;
       last_score = bestScore;
+      last_bound = depth_completed ? TT_EXACT : TT_LOWER;
+      root_scores.assign(scores, scores + scored);
 
       search_progress.completed_depth.store(depth, std::memory_order_relaxed);
       search_progress.score_cp.store(bestScore, std::memory_order_relaxed);
@@ -900,7 +692,7 @@ Move ChessEngine::getBestMoveWithTime(int time_ms) {
         info.depth = depth;
         info.score_cp = bestScore;
         info.nodes = (uint64_t)searchStats.nodes;
-        info.time_ms = SDL_GetTicks() - start_time;
+        info.time_ms = now_ms() - start_time;
         info.pv = moveToUCI(bestMove);
         info.hash_hit_pct = safe_pct(searchStats.hash_hits, searchStats.nodes);
         info.fail_high_first_pct =
@@ -915,14 +707,170 @@ Move ChessEngine::getBestMoveWithTime(int time_ms) {
       }
     }
 
+    if (!depth_completed)
+      break;
+
     if (std::abs(bestScore) > MATE_BOUND)
       break;
   }
 
+  return bestMove;
+}
+
+void ChessEngine::setThreads(int n) {
+  num_threads = std::max(1, std::min(n, MAX_THREADS));
+}
+
+void ChessEngine::setHashSize(int mb) {
+  tt->resize((size_t)std::max(1, mb), num_threads);
+}
+
+void ChessEngine::startHelpers(int maxDepth) {
+  while ((int)helpers.size() < num_threads - 1)
+    helpers.push_back(std::unique_ptr<ChessEngine>(new ChessEngine(tt)));
+  helpers.resize(num_threads - 1);
+
+  for (size_t i = 0; i < helpers.size(); i++) {
+    ChessEngine *h = helpers[i].get();
+    h->position = position;
+    h->invalidateAccumulators();
+    h->setNetwork(network, use_nnue);
+    h->moveStack = moveStack;
+    h->repetition_history = repetition_history;
+    h->start_time = start_time;
+    h->allocated_time_ms = 0; // the main thread decides when helpers stop
+    h->time_up_flag = false;
+    h->clearKillers();
+    h->resetSearchStats();
+
+    // odd helpers start one ply deeper so the threads desynchronise
+    int startDepth = 1 + (int)(i & 1);
+    helper_threads.emplace_back(
+        [h, maxDepth, startDepth] { h->iterativeDeepening(maxDepth, startDepth); });
+  }
+}
+
+void ChessEngine::stopHelpers() {
+  for (auto &h : helpers)
+    h->stop();
+  for (std::thread &t : helper_threads)
+    t.join();
+  helper_threads.clear();
+
+  for (auto &h : helpers)
+    total_nodes += h->searchStats.nodes;
+}
+
+Move ChessEngine::getBestMove(int maxDepth) {
+  Move bookMove = getOpeningBookMove();
+  if (bookMove != Move())
+    return bookMove;
+
+  {
+    std::lock_guard<std::mutex> lk(iteration_log_mutex);
+    iteration_log.clear();
+  }
+
+  start_time = now_ms();
+  allocated_time_ms = 0;
+  time_up_flag = false;
+
+  clearKillers();
+  if (ages_tt)
+    tt->newSearch();
+
+  search_progress.active.store(true, std::memory_order_relaxed);
+  search_progress.start_ms.store(start_time, std::memory_order_relaxed);
+  search_progress.depth.store(0, std::memory_order_relaxed);
+  search_progress.completed_depth.store(0, std::memory_order_relaxed);
+  search_progress.nodes.store(0, std::memory_order_relaxed);
+  search_progress.qnodes.store(0, std::memory_order_relaxed);
+  search_progress.hash_hits.store(0, std::memory_order_relaxed);
+  search_progress.fail_high.store(0, std::memory_order_relaxed);
+  search_progress.fail_high_first.store(0, std::memory_order_relaxed);
+
+  int64_t nodes_before = searchStats.nodes;
+  startHelpers(maxDepth);
+  Move bestMove = iterativeDeepening(maxDepth, 1);
+  stopHelpers();
+  total_nodes += searchStats.nodes - nodes_before;
+
+  search_progress.active.store(false, std::memory_order_relaxed);
+
+  return bestMove;
+}
+
+Move ChessEngine::getBestMoveWithTime(int time_ms, int maxDepth) {
+  Move bookMove = getOpeningBookMove();
+  if (bookMove != Move())
+    return bookMove;
+
+  {
+    std::lock_guard<std::mutex> lk(iteration_log_mutex);
+    iteration_log.clear();
+  }
+
+  start_time = now_ms();
+  allocated_time_ms = time_ms;
+  time_up_flag = false;
+
+  clearKillers();
+  if (ages_tt)
+    tt->newSearch();
+
+  int64_t nodes_before = searchStats.nodes;
+  startHelpers(maxDepth);
+  Move bestMove = iterativeDeepening(maxDepth, 1);
+  stopHelpers();
+  total_nodes += searchStats.nodes - nodes_before;
+
   search_progress.active.store(false, std::memory_order_relaxed);
   return bestMove;
 }
 
+SearchResult ChessEngine::searchWithLimits(const SearchLimits &limits) {
+  int depth = limits.depth > 0 ? std::min(limits.depth, MAX_B_DEPTH)
+                               : MAX_B_DEPTH;
+
+  resetSearchStats();
+  setNodeLimit(limits.nodes);
+  uint32_t start = now_ms();
+  Move best = limits.time_ms > 0 ? getBestMoveWithTime(limits.time_ms, depth)
+                                 : getBestMove(depth);
+  setNodeLimit(0);
+
+  SearchResult r;
+  r.time_ms = now_ms() - start;
+  r.nodes = total_nodes;
+  r.depth = last_search_depth;
+  r.score = last_score;
+  r.bound = last_bound;
+  if (best != Move()) {
+    r.best_move = moveToUCI(best);
+    for (Move m : principalVariation(best, std::max(1, r.depth)))
+      r.pv.push_back(moveToUCI(m));
+  }
+  for (const RootMoveScore &rm : root_scores)
+    r.root_moves.push_back({moveToUCI(rm.move), rm.score, rm.bound});
+  return r;
+}
+
+std::vector<Move> ChessEngine::principalVariation(Move best, int maxLength) {
+  std::vector<Move> pv;
+  Move m = best;
+  while (m != Move() && (int)pv.size() < maxLength && position.is_legal(m)) {
+    pv.push_back(m);
+    makeMove(m);
+    if (isRepetition())
+      break;
+    TTEntry e;
+    m = tt->probe(position.get_hash(), e) ? e.bestMove : Move();
+  }
+  for (size_t i = 0; i < pv.size(); i++)
+    unmakeMove();
+  return pv;
+}
+
 Move ChessEngine::parseMoveString(const std::string &moveStr) {
   if (moveStr.length() < 4)
     return Move();
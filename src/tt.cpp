@@ -0,0 +1,200 @@
+#include "tt.h"
+#include "bitboard.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+void TranspositionTable::resize(size_t mb, int threads) {
+  mb = std::max<size_t>(1, std::min<size_t>(mb, MAX_HASH_MB));
+  if (mb == size_mb && buckets)
+    return;
+
+  // free the old table first so peak memory is one table, not two
+  buckets.reset();
+  count = mb * 1024 * 1024 / sizeof(TTBucket);
+  buckets.reset(new TTBucket[count]);
+  size_mb = mb;
+  clear(threads);
+}
+
+void TranspositionTable::clear(int threads) {
+  age = 0;
+  if (!buckets)
+    return;
+
+  threads = std::max(1, threads);
+  if (threads == 1) {
+    std::memset(buckets.get(), 0, count * sizeof(TTBucket));
+    return;
+  }
+
+  std::vector<std::thread> workers;
+  size_t chunk = (count + threads - 1) / threads;
+  for (int i = 0; i < threads; i++) {
+    size_t begin = i * chunk;
+    if (begin >= count)
+      break;
+    size_t len = std::min(chunk, count - begin);
+    workers.emplace_back([this, begin, len] {
+      std::memset(buckets.get() + begin, 0, len * sizeof(TTBucket));
+    });
+  }
+  for (std::thread &t : workers)
+    t.join();
+}
+
+static inline uint64_t load_slot(uint64_t &slot) {
+  return std::atomic_ref<uint64_t>(slot).load(std::memory_order_relaxed);
+}
+
+static inline void store_slot(uint64_t &slot, uint64_t w) {
+  std::atomic_ref<uint64_t>(slot).store(w, std::memory_order_relaxed);
+}
+
+bool TranspositionTable::probe(uint64_t key, TTEntry &out) const {
+  const uint16_t key16 = (uint16_t)key;
+  TTBucket &b = bucket(key);
+  for (uint64_t &slot : b.slots) {
+    TTEntry e = TTEntry::unpack(load_slot(slot));
+    if (e.key16 == key16 && !e.empty()) {
+      out = e;
+      return true;
+    }
+  }
+  return false;
+}
+
+void TranspositionTable::store(uint64_t key, int depth, int score,
+                               TTBound bound, Move move) {
+  const uint16_t key16 = (uint16_t)key;
+  TTBucket &b = bucket(key);
+
+  // reuse this position's slot if it has one, otherwise evict the slot
+  // that is shallowest once older generations are discounted
+  uint64_t *replace = &b.slots[0];
+  TTEntry old = TTEntry::unpack(load_slot(b.slots[0]));
+  int worst = 1 << 30;
+  for (uint64_t &slot : b.slots) {
+    TTEntry e = TTEntry::unpack(load_slot(slot));
+    if (e.key16 == key16 && !e.empty()) {
+      replace = &slot;
+      old = e;
+      break;
+    }
+    int staleness = (TT_GENERATIONS + age - e.generation()) % TT_GENERATIONS;
+    int value = e.depth8 - 8 * staleness;
+    if (value < worst) {
+      worst = value;
+      replace = &slot;
+      old = e;
+    }
+  }
+
+  if (old.key16 == key16 && !old.empty()) {
+    if (old.generation() == age && old.depth() > depth &&
+        old.bound() == TT_EXACT && bound != TT_EXACT)
+      return;
+    if (move == Move())
+      move = old.bestMove;
+  }
+
+  TTEntry e;
+  e.key16 = key16;
+  e.bestMove = move;
+  e.score = (int16_t)score;
+  e.depth8 = (uint8_t)std::max(0, std::min(254, depth) + 1);
+  e.genBound = (uint8_t)(age << 2 | bound);
+  store_slot(*replace, e.pack());
+}
+
+#define TT_FILE_VERSION 1
+
+struct TTFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t bucket_bytes;
+  uint64_t zobrist_check;
+  uint64_t size_mb;
+  uint64_t count;
+  uint64_t age;
+};
+
+// folds every zobrist key so a table hashed under another seed is refused
+static uint64_t zobrist_fingerprint() {
+  uint64_t h = zobrist::zobrist_side;
+  for (int pc = 0; pc < (int)NPIECES; pc++)
+    for (int sq = 0; sq < (int)NSQUARES; sq++)
+      h = (h << 7 | h >> 57) ^ zobrist::zobrist_table[pc][sq];
+  for (int f = 0; f < 8; f++)
+    h = (h << 7 | h >> 57) ^ zobrist::zobrist_ep[f];
+  return h;
+}
+
+bool TranspositionTable::save(const std::string &path) const {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    std::cerr << "Could not open hash file for writing: " << path << std::endl;
+    return false;
+  }
+
+  TTFileHeader h{};
+  std::memcpy(h.magic, "CGSTT", 5);
+  h.version = TT_FILE_VERSION;
+  h.bucket_bytes = sizeof(TTBucket);
+  h.zobrist_check = zobrist_fingerprint();
+  h.size_mb = size_mb;
+  h.count = count;
+  h.age = age;
+
+  file.write(reinterpret_cast<const char *>(&h), sizeof(h));
+  file.write(reinterpret_cast<const char *>(buckets.get()),
+             (std::streamsize)(count * sizeof(TTBucket)));
+  return file.good();
+}
+
+bool TranspositionTable::load(const std::string &path, int threads) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Could not open hash file: " << path << std::endl;
+    return false;
+  }
+
+  TTFileHeader h{};
+  if (!file.read(reinterpret_cast<char *>(&h), sizeof(h)) ||
+      std::memcmp(h.magic, "CGSTT", 5) != 0) {
+    std::cerr << "Not a hash file: " << path << std::endl;
+    return false;
+  }
+  if (h.version != TT_FILE_VERSION || h.bucket_bytes != sizeof(TTBucket) ||
+      h.zobrist_check != zobrist_fingerprint()) {
+    std::cerr << "Stale hash file (format or zobrist keys changed): " << path
+              << std::endl;
+    return false;
+  }
+  if (h.size_mb == 0 || h.size_mb > MAX_HASH_MB ||
+      h.count != h.size_mb * 1024 * 1024 / sizeof(TTBucket)) {
+    std::cerr << "Corrupt hash file header: " << path << std::endl;
+    return false;
+  }
+
+  // bucket indices depend on the bucket count, so adopt the saved size
+  if (h.size_mb != size_mb || !buckets) {
+    buckets.reset();
+    count = h.count;
+    buckets.reset(new TTBucket[count]);
+    size_mb = h.size_mb;
+  }
+
+  if (!file.read(reinterpret_cast<char *>(buckets.get()),
+                 (std::streamsize)(count * sizeof(TTBucket)))) {
+    std::cerr << "Truncated hash file: " << path << std::endl;
+    clear(threads);
+    return false;
+  }
+  age = (uint8_t)(h.age % TT_GENERATIONS);
+  return true;
+}
@@ -510,7 +510,7 @@ void Window::DrawDebugPanel() {
   uint64_t qn = p.qnodes.load(std::memory_order_relaxed);
   int score = p.score_cp.load(std::memory_order_relaxed);
   uint32_t t0 = p.start_ms.load(std::memory_order_relaxed);
-  uint32_t elapsed_ms = busy && t0 ? (SDL_GetTicks() - t0) : 0;
+  uint32_t elapsed_ms = busy && t0 ? (now_ms() - t0) : 0;
   double elapsed_s = elapsed_ms / 1000.0;
   uint64_t nps =
       elapsed_s > 0.001 ? static_cast<uint64_t>(nodes / elapsed_s) : 0;
@@ -0,0 +1,42 @@
+# runs chessgs annotate on IN and checks OUT against it: each position line
+# annotated, each unreadable line copied through, and a failing exit code
+# since some lines could not be read
+
+# EPD operations end in ';', which is also CMake's list separator
+function(read_lines path var)
+    file(READ "${path}" text)
+    string(REPLACE ";" "@" text "${text}")
+    string(REGEX REPLACE "\n$" "" text "${text}")
+    string(REPLACE "\n" ";" text "${text}")
+    set(${var} "${text}" PARENT_SCOPE)
+endfunction()
+
+execute_process(
+    COMMAND "${CHESSGS}" annotate "${IN}" "${OUT}" 2 3
+    RESULT_VARIABLE result
+)
+if(result EQUAL 0)
+    message(FATAL_ERROR "annotate succeeded on input with unreadable lines")
+endif()
+
+read_lines("${IN}" input)
+read_lines("${OUT}" output)
+list(FILTER input EXCLUDE REGEX "^#|^[ \t]*$")
+list(LENGTH input expected)
+list(LENGTH output actual)
+if(NOT expected EQUAL actual)
+    message(FATAL_ERROR "${actual} output lines for ${expected} positions")
+endif()
+
+math(EXPR last "${expected} - 1")
+foreach(i RANGE ${last})
+    list(GET input ${i} in_line)
+    list(GET output ${i} out_line)
+    if(in_line MATCHES "unknown piece|seven ranks|no side|in check|^not a")
+        if(NOT out_line STREQUAL in_line)
+            message(FATAL_ERROR "unreadable line changed: ${out_line}")
+        endif()
+    elseif(NOT out_line MATCHES "acd 3@ acn [0-9]+@ ce -?[0-9]+@ pm [a-h][1-8][a-h][1-8]")
+        message(FATAL_ERROR "line not annotated: ${out_line}")
+    endif()
+endforeach()
@@ -0,0 +1,17 @@
+# runs chessgs perftsuite on IN, which holds a corrupt position whose count
+# would otherwise match, and checks the run reports it and fails cleanly
+
+execute_process(
+    COMMAND "${CHESSGS}" perftsuite "${IN}" 1
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE output
+)
+if(NOT result EQUAL 1)
+    message(FATAL_ERROR "perftsuite exited with ${result}, expected 1")
+endif()
+if(NOT output MATCHES "not a playable position  FAIL")
+    message(FATAL_ERROR "corrupt position not reported:\n${output}")
+endif()
+if(NOT output MATCHES "1/2 positions")
+    message(FATAL_ERROR "valid position not counted:\n${output}")
+endif()